@@ -6,35 +6,62 @@
 #include <raindance/Core/Light.hh>
 #include <raindance/Core/Material.hh>
 
+#include <chrono>
+
+#include "Common/Arena.hh"
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Capture.hh"
+#include "Common/CommandBuffer.hh"
+#include "Common/Memory.hh"
+#include "Common/Profiler.hh"
+#include "Common/Replay.hh"
+#include "Common/StreamingBuffer.hh"
+#include "Common/Transforms.hh"
+#include "Common/Uniforms.hh"
+
 const std::string g_VertexShader = "                                                      \n\
     #version 330                                                                          \n\
-    struct Light                                                                          \n\
+    layout(std140) uniform Camera                                                         \n\
+    {                                                                                     \n\
+        mat4 u_ViewMatrix;                                                                \n\
+        mat4 u_ProjectionMatrix;                                                          \n\
+    };                                                                                    \n\
+                                                                                          \n\
+    layout(std140) uniform Light                                                          \n\
     {                                                                                     \n\
         int Type;                                                                         \n\
         vec3 Position;                                                                    \n\
         vec3 Direction;                                                                   \n\
         vec3 Color;                                                                       \n\
-    };                                                                                    \n\
+    } u_Light;                                                                            \n\
                                                                                           \n\
-    struct Material                                                                       \n\
+    layout(std140) uniform Material                                                       \n\
     {                                                                                     \n\
         vec3 Ambient;                                                                     \n\
         vec4 Diffuse;                                                                     \n\
         vec3 Specular;                                                                    \n\
         float Shininess;                                                                  \n\
-    };                                                                                    \n\
+    } u_Material;                                                                         \n\
                                                                                           \n\
     layout(location = 0) in vec3 a_Position;                                              \n\
     layout(location = 1) in vec3 a_Normal;                                                \n\
     // layout(location = 2) in vec2 a_Texcoord;                                           \n\
                                                                                           \n\
+    #ifdef INSTANCED                                                                      \n\
+    layout(location = 3) in mat4 a_ModelMatrix;                                           \n\
+    layout(location = 7) in mat3 a_NormalMatrix;                                          \n\
+    layout(location = 10) in vec4 a_Diffuse;                                              \n\
+    #define MODEL_MATRIX a_ModelMatrix                                                    \n\
+    #define NORMAL_MATRIX a_NormalMatrix                                                  \n\
+    #define DIFFUSE a_Diffuse                                                             \n\
+    #else                                                                                 \n\
     uniform mat4 u_ModelMatrix;                                                           \n\
-    uniform mat4 u_ViewMatrix;                                                            \n\
-    uniform mat4 u_ProjectionMatrix;                                                      \n\
     uniform mat3 u_NormalMatrix;                                                          \n\
-                                                                                          \n\
-    uniform Light u_Light;                                                                \n\
-    uniform Material u_Material;                                                          \n\
+    #define MODEL_MATRIX u_ModelMatrix                                                    \n\
+    #define NORMAL_MATRIX u_NormalMatrix                                                  \n\
+    #define DIFFUSE u_Material.Diffuse                                                    \n\
+    #endif                                                                                \n\
                                                                                           \n\
     out vec3 v_Position;                                                                  \n\
     // out vec2 v_Texcoord;                                                               \n\
@@ -43,8 +70,8 @@ const std::string g_VertexShader = "
                                                                                           \n\
     void main(void)                                                                       \n\
     {                                                                                     \n\
-        v_Position = vec3(u_ViewMatrix * u_ModelMatrix * vec4(a_Position, 1.0));          \n\
-        v_Normal = normalize(u_NormalMatrix * a_Normal);                                  \n\
+        v_Position = vec3(u_ViewMatrix * MODEL_MATRIX * vec4(a_Position, 1.0));           \n\
+        v_Normal = normalize(NORMAL_MATRIX * a_Normal);                                   \n\
         // v_Texcoord = a_Texcoord;                                                       \n\
                                                                                           \n\
         v_Color = vec4(u_Material.Ambient, 0.0);                                          \n\
@@ -55,7 +82,7 @@ const std::string g_VertexShader = "
                                                                                           \n\
         if (lambert > 0.0)                                                                \n\
         {                                                                                 \n\
-            v_Color += vec4(u_Light.Color, 0.0) * u_Material.Diffuse * lambert;           \n\
+            v_Color += vec4(u_Light.Color, 0.0) * DIFFUSE * lambert;                      \n\
                                                                                           \n\
             vec3 eyeDirection = normalize(-v_Position);                                   \n\
             vec3 r = reflect(-lightDirection, v_Normal);                                  \n\
@@ -65,7 +92,7 @@ const std::string g_VertexShader = "
             v_Color += vec4(u_Material.Specular * specular, 0.0);                         \n\
         }                                                                                 \n\
                                                                                           \n\
-        v_Color.a = u_Material.Diffuse.a;                                                 \n\
+        v_Color.a = DIFFUSE.a;                                                            \n\
         gl_Position = u_ProjectionMatrix * vec4(v_Position, 1.0);                         \n\
     }                                                                                     \n\
 ";
@@ -85,9 +112,37 @@ const std::string g_FragmentShader = "  \n\
     }                                   \n\
 ";
 
+// Command line options :
+//
+//     --no-lod    Draws every agent with the full Cylinder, one draw call each
+//     --sweep     Moves the camera from inside the crowd out to far away and back every 600 frames
+//
+// agents --headless --sweep --frames 600 [--no-lod] reports triangles and frame times for both.
+bool g_LOD = true;
+bool g_Sweep = false;
+
 class DemoWindow : public rd::Window
 {
 public:
+    // Cylinder tessellations, from the original mesh down, and the projected radius in pixels
+    // an agent needs to be drawn with each of them.
+    enum { LOD_COUNT = 4 };
+
+    struct LevelOfDetail
+    {
+        int Slices;
+        int Stacks;
+        float Pixels;
+    };
+
+    // NOTE : Must match the per instance attributes of the INSTANCED vertex shader.
+    struct Instance
+    {
+        glm::mat4 ModelMatrix;
+        glm::vec4 NormalMatrix[3];
+        glm::vec4 Diffuse;
+    };
+
     struct Agent
     {
 		glm::vec3 Position;	
@@ -119,12 +174,36 @@ public:
         m_Grid = NULL;
         m_Agent = NULL;
         m_AgentShader = NULL;
+        m_InstancedShader = NULL;
+        m_InstanceStream = NULL;
+        for (int lod = 0; lod < LOD_COUNT; lod++)
+            m_LODs[lod] = NULL;
+        m_Height = settings->Height;
+        m_Frame = 0;
+        m_CameraBlock = NULL;
+        m_LightBlock = NULL;
+        m_MaterialBlock = NULL;
+        m_Queue = NULL;
     }
 
     virtual ~DemoWindow()
     {
+        for (auto agent : m_Agents)
+            m_AgentPool.destroy(agent);
+
         SAFE_DELETE(m_Grid);
+        SAFE_DELETE(m_CameraBlock);
+        SAFE_DELETE(m_LightBlock);
+        SAFE_DELETE(m_MaterialBlock);
+        if (m_Queue)
+            m_Queue->dump("Agents/queue");
+        SAFE_DELETE(m_Queue);
+        SAFE_DELETE(m_InstanceStream);
+        for (int lod = 1; lod < LOD_COUNT; lod++)
+            SAFE_DELETE(m_LODs[lod]);
         ResourceManager::getInstance().unload(m_AgentShader);
+        if (m_InstancedShader)
+            ResourceManager::getInstance().unload(m_InstancedShader);
     }
 
     virtual void initialize(Context* context)
@@ -142,12 +221,15 @@ public:
         params.Color = glm::vec4(0.5, 0.5, 0.5, 1.0);
         //params.BackgroundColor = 0.5f * params.Color;
 
-        m_Grid = new Grid(params);
+        {
+            MEMORY_SCOPE("Agents::Grid");
+            m_Grid = new Grid(params);
+        }
 
         float radius = 32;
         for (float alpha = 0; alpha < 2 * M_PI; alpha += 0.05)
         {
-            auto agent = new Agent();
+            auto agent = m_AgentPool.create();
 
             agent->Position.x = RANDOM_FLOAT(0.1, 1.0) * radius * cos(alpha);
             agent->Position.y = 0;
@@ -164,13 +246,77 @@ public:
             m_Agents.push_back(agent);
         }
 
-        m_Agent = new Cylinder(0.5, 0.5, 15, 10, glm::vec3(0, 0.5, 0));
-        m_AgentShader = ResourceManager::getInstance().loadShader("Agents/Agent", g_VertexShader, g_FragmentShader);
+        {
+            MEMORY_SCOPE("Agents::Cylinder");
+            m_Agent = new Cylinder(0.5, 0.5, 15, 10, glm::vec3(0, 0.5, 0));
+            m_AgentShader = ResourceManager::getInstance().loadShader("Agents/Agent", g_VertexShader, g_FragmentShader);
+        }
+
+        if (g_LOD)
+        {
+            MEMORY_SCOPE("Agents::LOD");
+
+            // NOTE : The original mesh is the finest level, the others are generated once here.
+            m_LODs[0] = m_Agent;
+            for (int lod = 1; lod < LOD_COUNT; lod++)
+                m_LODs[lod] = new Cylinder(0.5, 0.5, LODs()[lod].Slices, LODs()[lod].Stacks, glm::vec3(0, 0.5, 0));
+
+            std::string source = g_VertexShader;
+            source.insert(source.find('\n', source.find("#version")) + 1, "    #define INSTANCED\n");
+            m_InstancedShader = ResourceManager::getInstance().loadShader("Agents/AgentInstanced", source, g_FragmentShader);
+
+            m_InstanceStream = new StreamingBuffer(GL_ARRAY_BUFFER, m_Agents.size() * sizeof(Instance));
+        }
         // m_AgentShader->dump();
 
         m_Light.setPosition(glm::vec3(128, 128, 0));
         m_Light.setColor(glm::vec3(1.2, 1.2, 1.2));
 
+        m_AgentShader->use();
+        GLuint agentProgram = Uniforms::current();
+        m_ModelMatrix = Uniforms::Location(agentProgram, "u_ModelMatrix");
+        m_NormalMatrix = Uniforms::Location(agentProgram, "u_NormalMatrix");
+
+        MEMORY_SCOPE("Agents::Uniforms");
+
+        m_CameraBlock = new Uniforms::Block<Uniforms::CameraBlock>(Uniforms::CAMERA);
+        m_LightBlock = new Uniforms::Block<Uniforms::LightBlock>(Uniforms::LIGHT);
+        m_MaterialBlock = new Uniforms::Block<Uniforms::MaterialBlock>(Uniforms::MATERIAL, m_Agents.size());
+
+        m_CameraBlock->attach(agentProgram, "Camera");
+        m_LightBlock->attach(agentProgram, "Light");
+        m_MaterialBlock->attach(agentProgram, "Material");
+
+        if (m_InstancedShader)
+        {
+            m_InstancedShader->use();
+            GLuint instancedProgram = Uniforms::current();
+            m_CameraBlock->attach(instancedProgram, "Camera");
+            m_LightBlock->attach(instancedProgram, "Light");
+            m_MaterialBlock->attach(instancedProgram, "Material");
+        }
+
+        // NOTE : Agent materials never change, they are uploaded once and only rebound per draw.
+        for (size_t i = 0; i < m_Agents.size(); i++)
+        {
+            Uniforms::MaterialBlock& material = (*m_MaterialBlock)[i];
+            material.Ambient = m_Material.getAmbient();
+            material.Diffuse = m_Agents[i]->Color;
+            material.Specular = m_Material.getSpecular();
+            material.Shininess = m_Material.getShininess();
+        }
+        m_MaterialBlock->update();
+
+        updateTransforms();
+
+        m_Queue = new RenderQueue();
+        m_AgentProgram = m_Queue->program(m_AgentShader);
+        m_AgentGeometry = m_Queue->geometry(&m_Agent->getVertexBuffer());
+
+        m_Commands.resize(Parallel::concurrency());
+        for (auto& commands : m_Commands)
+            m_CommandBuffers.push_back(&commands);
+
         glClearColor(0.2, 0.2, 0.2, 1.0);
         glEnable(GL_DEPTH_TEST);
 
@@ -181,59 +327,243 @@ public:
     virtual void reshape(int width, int height)
     {
         m_Camera3D.resize(width, height);
+        m_Height = height;
     }
 
-    virtual void draw(Context* context)
+    static const LevelOfDetail* LODs()
     {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        static const LevelOfDetail lods[LOD_COUNT] =
+        {
+            { 15, 10, 40.0f },
+            { 10, 4, 16.0f },
+            { 6, 2, 6.0f },
+            { 4, 1, 0.0f }
+        };
+        return lods;
+    }
 
-        Transformation transformation;
+    void updateTransforms()
+    {
+        m_Transforms.resize(m_Agents.size());
+        for (size_t i = 0; i < m_Agents.size(); i++)
+        {
+            m_Transforms.setTranslation(i, m_Agents[i]->Position);
+            m_Transforms.setScale(i, glm::vec3(m_Agents[i]->Width, m_Agents[i]->Height, m_Agents[i]->Width));
+        }
+    }
 
-        transformation.push();
-        transformation.rotate(90, glm::vec3(1.0, 0, 0));
-        transformation.translate(glm::vec3(-m_Grid->parameters().Dimension.x / 2, -m_Grid->parameters().Dimension.y / 2, 0));
-        m_Grid->draw(context, m_Camera3D, transformation);
-        transformation.pop();
+    void drawAgents(Context* context)
+    {
+        PROFILE_GPU_ZONE("Agents::draw");
 
-        m_AgentShader->use();
-        m_AgentShader->uniform("u_ProjectionMatrix").set(m_Camera3D.getProjectionMatrix());
-        m_AgentShader->uniform("u_ViewMatrix").set(m_Camera3D.getViewMatrix());
+        (*m_CameraBlock)[0].set(m_Camera3D);
+        m_CameraBlock->update();
+        (*m_LightBlock)[0].set(m_Light);
+        m_LightBlock->update();
+
+        m_Transforms.update(m_Camera3D.getViewMatrix());
+
+        {
+            PROFILE_ZONE("Agents::record");
+
+            size_t partitions = m_Commands.size();
+            Parallel::forEach(partitions, [&](size_t begin, size_t end)
+            {
+                for (size_t p = begin; p < end; p++)
+                    recordAgents(m_Commands[p], p * m_Agents.size() / partitions, (p + 1) * m_Agents.size() / partitions);
+            }, 1);
+        }
+
+        {
+            PROFILE_GPU_ZONE("Agents::submit");
+            m_Queue->submit(context, m_CommandBuffers);
+        }
+    }
+
+    // Picks a level of detail per agent from its projected radius, in pixels.
+    void binAgents(unsigned int* counts, uint8_t* lods)
+    {
+        const glm::mat4 view = m_Camera3D.getViewMatrix();
+        const float scale = m_Camera3D.getProjectionMatrix()[1][1] * 0.5f * m_Height;
+
+        for (int lod = 0; lod < LOD_COUNT; lod++)
+            counts[lod] = 0;
+
+        for (size_t i = 0; i < m_Agents.size(); i++)
+        {
+            const Agent& agent = *m_Agents[i];
+
+            glm::vec4 center = view * glm::vec4(agent.Position + glm::vec3(0, agent.Height / 2, 0), 1.0);
+            float depth = -center.z;
+            float pixels = depth > 0 ? scale * 0.5f * std::max(agent.Width, agent.Height) / depth : 0.0f;
+
+            int lod = 0;
+            while (lod < LOD_COUNT - 1 && pixels < LODs()[lod].Pixels)
+                lod++;
+
+            lods[i] = static_cast<uint8_t>(lod);
+            counts[lod]++;
+        }
+    }
+
+    void drawAgentsLOD(Context* context)
+    {
+        PROFILE_GPU_ZONE("Agents::draw");
 
-        m_AgentShader->uniform("u_Light.Type").set(m_Light.getType());
-        m_AgentShader->uniform("u_Light.Position").set(m_Light.getPosition());
-        m_AgentShader->uniform("u_Light.Direction").set(m_Light.getDirection());
-        m_AgentShader->uniform("u_Light.Color").set(m_Light.getColor());
+        (*m_CameraBlock)[0].set(m_Camera3D);
+        m_CameraBlock->update();
+        (*m_LightBlock)[0].set(m_Light);
+        m_LightBlock->update();
 
-        for (auto& agent : m_Agents)
+        m_Transforms.update(m_Camera3D.getViewMatrix());
+
+        unsigned int counts[LOD_COUNT];
+        unsigned int offsets[LOD_COUNT];
         {
-			transformation.push();
-        	{
-				transformation.translate(agent->Position);
-            	transformation.scale(glm::vec3(agent->Width, agent->Height, agent->Width));
-                        
-                m_AgentShader->uniform("u_ModelMatrix").set(transformation.state());
-                m_AgentShader->uniform("u_NormalMatrix").set(glm::transpose(glm::inverse(glm::mat3(m_Camera3D.getViewMatrix() * transformation.state()))));
-                        
-                m_AgentShader->uniform("u_Material.Ambient").set(m_Material.getAmbient());
-                m_AgentShader->uniform("u_Material.Diffuse").set(agent->Color);
-                m_AgentShader->uniform("u_Material.Specular").set(m_Material.getSpecular());
-                m_AgentShader->uniform("u_Material.Shininess").set(m_Material.getShininess());
-                        
-                context->geometry().bind(m_Agent->getVertexBuffer(), *m_AgentShader);
-                context->geometry().drawArrays(GL_TRIANGLE_STRIP, 0, m_Agent->getVertexBuffer().size() / sizeof(Cylinder::Vertex));
-                context->geometry().unbind(m_Agent->getVertexBuffer());
+            PROFILE_ZONE("Agents::bin");
+
+            uint8_t* lods = m_FrameArena.allocate<uint8_t>(m_Agents.size());
+            binAgents(counts, lods);
+
+            unsigned int offset = 0;
+            for (int lod = 0; lod < LOD_COUNT; lod++)
+            {
+                offsets[lod] = offset;
+                offset += counts[lod];
+            }
+
+            // NOTE : No region to write this frame, the agents are skipped rather than drawn from stale data.
+            Instance* instances = static_cast<Instance*>(m_InstanceStream->map());
+            if (instances == NULL)
+                return;
+
+            for (size_t i = 0; i < m_Agents.size(); i++)
+            {
+                Instance& instance = instances[offsets[lods[i]]++];
+                const glm::mat3& normal = m_Transforms.normal(i);
+
+                instance.ModelMatrix = m_Transforms.model(i);
+                instance.NormalMatrix[0] = glm::vec4(normal[0], 0.0);
+                instance.NormalMatrix[1] = glm::vec4(normal[1], 0.0);
+                instance.NormalMatrix[2] = glm::vec4(normal[2], 0.0);
+                instance.Diffuse = m_Agents[i]->Color;
             }
-		    transformation.pop();
+            m_InstanceStream->unmap();
+        }
+
+        // NOTE : Ambient, specular and shininess are the same for every agent, diffuse comes per instance.
+        m_InstancedShader->use();
+        m_MaterialBlock->bindRange(0);
+
+        size_t first = 0;
+        for (int lod = 0; lod < LOD_COUNT; lod++)
+        {
+            if (counts[lod] == 0)
+                continue;
+
+            Buffer& buffer = m_LODs[lod]->getVertexBuffer();
+            context->geometry().bind(buffer, *m_InstancedShader);
+
+            bindInstances(m_InstanceStream->offset() + first * sizeof(Instance));
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, buffer.size() / sizeof(Cylinder::Vertex), counts[lod]);
+            unbindInstances();
+
+            context->geometry().unbind(buffer);
+            first += counts[lod];
+        }
+
+        m_InstanceStream->fence();
+    }
+
+    // Attribute locations 3 - 6 (model matrix columns), 7 - 9 (normal matrix columns) and 10 (diffuse).
+    void bindInstances(size_t offset)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_InstanceStream->id());
+        for (GLuint i = 0; i < 4; i++)
+            attribute(3 + i, 4, offset + offsetof(Instance, ModelMatrix) + i * sizeof(glm::vec4));
+        for (GLuint i = 0; i < 3; i++)
+            attribute(7 + i, 3, offset + offsetof(Instance, NormalMatrix) + i * sizeof(glm::vec4));
+        attribute(10, 4, offset + offsetof(Instance, Diffuse));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void unbindInstances()
+    {
+        for (GLuint location = 3; location <= 10; location++)
+        {
+            glVertexAttribDivisor(location, 0);
+            glDisableVertexAttribArray(location);
+        }
+    }
+
+    static void attribute(GLuint location, GLint size, size_t offset)
+    {
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*) offset);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    void recordAgents(CommandBuffer& commands, size_t begin, size_t end)
+    {
+        GLsizei count = m_Agent->getVertexBuffer().size() / sizeof(Cylinder::Vertex);
+
+        commands.clear();
+        for (size_t i = begin; i < end; i++)
+        {
+            commands.uniform(m_ModelMatrix, m_Transforms.model(i));
+            commands.uniform(m_NormalMatrix, m_Transforms.normal(i));
+            commands.bindRange(*m_MaterialBlock, i);
+            commands.draw(m_AgentProgram, m_AgentGeometry, GL_TRIANGLE_STRIP, 0, count);
+        }
+    }
+
+    virtual void draw(Context* context)
+    {
+        PROFILE_GPU_ZONE("Window::draw");
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        m_Transformation.push();
+        m_Transformation.rotate(90, glm::vec3(1.0, 0, 0));
+        m_Transformation.translate(glm::vec3(-m_Grid->parameters().Dimension.x / 2, -m_Grid->parameters().Dimension.y / 2, 0));
+        {
+            PROFILE_GPU_ZONE("Grid::draw");
+            m_Grid->draw(context, m_Camera3D, m_Transformation);
         }
+        m_Transformation.pop();
+
+        if (g_LOD)
+            drawAgentsLOD(context);
+        else
+            drawAgents(context);
+
+        m_Capture.frame();
+
+        Profiler::getInstance().frame(context);
 	}
 
     virtual void idle(Context* context)
     {
+        PROFILE_ZONE("Window::idle");
+
         (void) context;
-        
-        float t = m_Clock.seconds();
 
-        m_Camera3D.lookAt(glm::vec3(48 * cos(t / 10), 20, 48 * sin(t / 10)), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+        m_FrameArena.reset();
+
+        // NOTE : Agents only depend on the seed and the time steps, replaying those is enough.
+        float t = Replay::getInstance().tick(m_Clock.seconds());
+
+        if (g_Sweep)
+        {
+            // NOTE : Driven by the frame count so runs with and without LOD see the same views,
+            // from inside the crowd out to where the whole grid is a few dozen pixels wide.
+            float phase = static_cast<float>(m_Frame % 600) / 600.0f;
+            float distance = 8.0f + 232.0f * (0.5f - 0.5f * cos(2 * M_PI * phase));
+            m_Camera3D.lookAt(glm::vec3(distance * cos(2 * M_PI * phase), 0.4f * distance, distance * sin(2 * M_PI * phase)), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+        }
+        else
+            m_Camera3D.lookAt(glm::vec3(48 * cos(t / 10), 20, 48 * sin(t / 10)), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+        m_Frame++;
 
 		glm::vec3 dim = glm::vec3(m_Grid->parameters().Dimension.x, 0, m_Grid->parameters().Dimension.y);
 
@@ -251,10 +581,14 @@ public:
 				agent->Position = nextPosition;
 		}
 
+        updateTransforms();
+
 		m_LastTime = t;
     }
 
 private:
+    Capture m_Capture;
+
     Clock m_Clock;
 	float m_LastTime;
 
@@ -264,22 +598,98 @@ private:
     Light m_Light;
     Material m_Material;
 
+    // NOTE : Kept across frames, a fresh Transformation allocates its matrix stack.
+    Transformation m_Transformation;
+
     Grid* m_Grid;
+    Pool<Agent> m_AgentPool;
     std::vector<Agent*> m_Agents;
 
+    // NOTE : Frame temporaries, reset at the top of idle().
+    Arena m_FrameArena;
+
     Cylinder* m_Agent;
     Shader::Program* m_AgentShader;
+
+    Cylinder* m_LODs[LOD_COUNT];
+    Shader::Program* m_InstancedShader;
+    StreamingBuffer* m_InstanceStream;
+    int m_Height;
+    unsigned long m_Frame;
+
+    TransformBatch m_Transforms;
+
+    Uniforms::Location m_ModelMatrix;
+    Uniforms::Location m_NormalMatrix;
+    Uniforms::Block<Uniforms::CameraBlock>* m_CameraBlock;
+    Uniforms::Block<Uniforms::LightBlock>* m_LightBlock;
+    Uniforms::Block<Uniforms::MaterialBlock>* m_MaterialBlock;
+
+    RenderQueue* m_Queue;
+    uint16_t m_AgentProgram;
+    uint16_t m_AgentGeometry;
+    std::vector<CommandBuffer> m_Commands;
+    std::vector<CommandBuffer*> m_CommandBuffers;
 };
 
+int measureTransforms(size_t count)
+{
+    TransformBatch batch;
+    batch.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        batch.setTranslation(i, glm::vec3(RANDOM_FLOAT(-32, 32), 0, RANDOM_FLOAT(-32, 32)));
+        batch.setScale(i, glm::vec3(RANDOM_FLOAT(1.0, 2.0), RANDOM_FLOAT(1.0, 3.0), RANDOM_FLOAT(1.0, 2.0)));
+    }
+
+    Camera camera;
+    camera.lookAt(glm::vec3(-50.0, 30.0, -50.0), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+    batch.update(camera.getViewMatrix());
+
+    const unsigned int updates = 100;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 0; i < updates; i++)
+        batch.update(camera.getViewMatrix());
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    LOG("transforms: %lu, threads: %u, %.3f ms/update, %.2f Mtransforms/s\n",
+        static_cast<unsigned long>(count),
+        Parallel::concurrency(),
+        seconds * 1000.0 / updates,
+        updates * count / seconds / 1e6);
+
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
-    auto demo = new Raindance(argc, argv);
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+    Capture::configure(argc, argv);
+    Replay::getInstance().configure(argc, argv);
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--transforms" && i + 1 < argc)
+            return measureTransforms(strtoul(argv[++i], NULL, 10));
+        else if (arg == "--no-lod")
+            g_LOD = false;
+        else if (arg == "--sweep")
+            g_Sweep = true;
+    }
 
     rd::Window::Settings settings;
     settings.Title = std::string("Agents");
     settings.Width = 1024;
     settings.Height = 728;
-    
+
+    if (benchmark.headless())
+        return benchmark.run<DemoWindow>(settings);
+
+    auto demo = new Raindance(argc, argv);
     demo->add(new DemoWindow(&settings));
     demo->run();
     delete demo;
@@ -0,0 +1,20 @@
+#version 330
+
+uniform mat4 u_ModelViewMatrix;
+uniform mat4 u_ProjectionMatrix;
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec3 a_Dimension;
+layout(location = 2) in vec4 a_Color;
+layout(location = 3) in vec2 a_Corner;
+
+out vec4 vs_Color;
+
+void main(void)
+{
+	vec3 pos = a_Position + vec3(a_Corner, 0.0) * a_Dimension;
+
+	gl_Position = u_ProjectionMatrix * u_ModelViewMatrix * vec4(pos, 1.0);
+
+	vs_Color = a_Color;
+}
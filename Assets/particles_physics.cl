@@ -19,23 +19,22 @@ __kernel void repulsion(__global float4* inNodes,
 }
 
 __kernel void attraction(__global float4* inNodes,
-                         __global ulong2* inEdges,
+                         __global uint* inOffsets,
+                         __global uint* inNeighbors,
                          __global float4* outDirections,
-                         const unsigned long count,
                          const float k)
 {
     unsigned int i = get_global_id(0);
-    unsigned long src = inEdges[i].x;
-    unsigned long dst = inEdges[i].y;
-    float4 pos1 = inNodes[src];
-    float4 pos2 = inNodes[dst];
-    float4 direction = pos1 - pos2;
-    float magnitude = length(direction);
-    if (magnitude > 100.0)
+    float4 pos1 = inNodes[i];
+    float4 f = (float4)(0.0);
+    for (uint n = inOffsets[i]; n < inOffsets[i + 1]; n++)
     {
-        outDirections[src] -= direction * magnitude / k;
-        outDirections[dst] += direction * magnitude / k;
+        float4 direction = pos1 - inNodes[inNeighbors[n]];
+        float magnitude = length(direction);
+        if (magnitude > 100.0)
+            f -= direction * magnitude / k;
     }
+    outDirections[i] += f;
 }
 
 __kernel void movement(__global float4* inNodes,
@@ -67,7 +66,7 @@ __kernel void sine_wave(__global Instance* instances, float time)
 
     instances[id].Translation.xyz = (float3)
     (
-        200 * cos(cos(float(id)) * time / 2 + id),
+        200 * cos(cos((float) id) * time / 2 + id),
         pos.y,
         pos.z
     );
@@ -0,0 +1,11 @@
+#version 330
+
+uniform mat4 u_ModelViewMatrix;
+uniform mat4 u_ProjectionMatrix;
+
+layout(location = 0) in vec2 a_Position;
+
+void main(void)
+{
+	gl_Position = u_ProjectionMatrix * u_ModelViewMatrix * vec4(a_Position, 0.0, 1.0);
+}
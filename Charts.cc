@@ -5,6 +5,26 @@
 #include <raindance/Core/Charts/HeightMap.hh>
 #include <raindance/Core/Charts/IconMap.hh>
 
+#include <chrono>
+
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Memory.hh"
+#include "Common/Profiler.hh"
+#include "Common/TextureHeightMap.hh"
+
+// Height map options :
+//
+//     --heightmap-texture       Values in a float texture, displaced on the GPU (TextureHeightMap)
+//     --heightmap-size N        N x N cells instead of 50 x 50, still drawn over 50 x 50 units
+//     --heightmap-updates       Rewrites a band of 16 rows every frame and logs the cost on exit
+//
+// charts --headless --heightmap-size 4096 --heightmap-updates [--heightmap-texture] compares
+// GPU memory (see the Memory dump) and update bandwidth of both representations.
+bool g_TextureHeightMap = false;
+unsigned int g_HeightMapSize = 50;
+bool g_HeightMapUpdates = false;
+
 class DemoWindow : public rd::Window
 {
 public:
@@ -15,6 +35,11 @@ public:
         m_LineChart1 = NULL;
         m_LineChart2 = NULL;
         m_HeightMap = NULL;
+        m_TextureHeightMap = NULL;
+        m_UpdateRow = 0;
+        m_Updates = 0;
+        m_UpdateBytes = 0;
+        m_UpdateTime = 0.0;
 
         m_Camera2D.setOrthographicProjection(0, 1024, 0, 728, 0.1f, 1024.0f);
         m_Camera2D.lookAt(glm::vec3(0.0, 0.0, 5.0), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
@@ -24,6 +49,8 @@ public:
         m_Camera3D.lookAt(glm::vec3(-50.0, 30.0, -50.0), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
 
         {
+            MEMORY_SCOPE("Charts::LineChart");
+
             m_LineChart1 = new LineChart(glm::vec2(0, 100), glm::vec2(0, 10));
             m_LineChart1->setTitle("Random()");
             m_LineChart1->setBackgroundColor(glm::vec4(HEX_COLOR(0x222222), 1.0));
@@ -40,6 +67,8 @@ public:
             m_LineChart1->update();
         }
         {
+            MEMORY_SCOPE("Charts::LineChart");
+
             m_LineChart2 = new LineChart(glm::vec2(-50, 50), glm::vec2(0, 10));
             m_LineChart2->setTitle("Gaussian Distributions");
             m_LineChart2->setBackgroundColor(glm::vec4(HEX_COLOR(0x222222), 1.0));
@@ -60,21 +89,23 @@ public:
             m_LineChart2->update();
         }
         {
-            m_HeightMap = new HeightMap(50, 50);
-
-            for (unsigned int i = 0; i < 50; i++)
-                for (unsigned int j = 0; j < 50; j++)
-                {
-                    float x = 2 * M_PI * static_cast<float>(i) / 50.0 - M_PI;
-                    float y = 2 * M_PI * static_cast<float>(j) / 50.0 - M_PI;
-                    m_HeightMap->setValue(i, j, sin(x * x) + cos(y * y) + RANDOM_FLOAT(-0.25, 0.25));
-                }
-            m_HeightMap->update();
+            MEMORY_SCOPE("Charts::HeightMap");
+
+            unsigned int size = g_HeightMapSize;
+            if (g_TextureHeightMap)
+                m_TextureHeightMap = new TextureHeightMap(size, size);
+            else
+                m_HeightMap = new HeightMap(size, size);
+
+            for (unsigned int j = 0; j < size; j++)
+                updateHeightMapRow(j, 0.0f);
+            updateHeightMap();
         }
         {
             const unsigned long size = 777;
             char* memory = new char[size];
 
+            MEMORY_SCOPE("Charts::IconMap");
             m_IconMap = new IconMap(16, size / 4 + 4);
 
             for (unsigned long i = 0; i < size; i++)
@@ -96,7 +127,47 @@ public:
         SAFE_DELETE(m_LineChart1);
         SAFE_DELETE(m_LineChart2);
         SAFE_DELETE(m_HeightMap);
+        SAFE_DELETE(m_TextureHeightMap);
         SAFE_DELETE(m_IconMap);
+
+        if (m_Updates > 0)
+            LOG("HeightMap : %s %ux%u, %.2f MB per update, %.3f ms per update (%lu updates)\n",
+                g_TextureHeightMap ? "texture" : "mesh", g_HeightMapSize, g_HeightMapSize,
+                m_UpdateBytes / (1024.0 * 1024.0) / m_Updates, m_UpdateTime / m_Updates, m_Updates);
+    }
+
+    inline void setHeight(unsigned int i, unsigned int j, float value)
+    {
+        if (m_TextureHeightMap)
+            m_TextureHeightMap->setValue(i, j, value);
+        else
+            m_HeightMap->setValue(i, j, value);
+    }
+
+    void updateHeightMapRow(unsigned int j, float t)
+    {
+        unsigned int size = g_HeightMapSize;
+        float y = 2 * M_PI * static_cast<float>(j) / size - M_PI;
+        for (unsigned int i = 0; i < size; i++)
+        {
+            float x = 2 * M_PI * static_cast<float>(i) / size - M_PI;
+            setHeight(i, j, sin(x * x + t) + cos(y * y) + RANDOM_FLOAT(-0.25, 0.25));
+        }
+    }
+
+    // Returns the number of bytes sent to the GPU.
+    size_t updateHeightMap()
+    {
+        if (m_TextureHeightMap)
+        {
+            m_TextureHeightMap->update();
+            return m_TextureHeightMap->uploaded();
+        }
+
+        // NOTE : The mesh is expanded and uploaded again as a whole, whatever changed.
+        unsigned long long uploaded = MemoryTracker::getInstance().uploaded();
+        m_HeightMap->update();
+        return static_cast<size_t>(MemoryTracker::getInstance().uploaded() - uploaded);
     }
     
     virtual void initialize(Context* context)
@@ -106,6 +177,8 @@ public:
 
     virtual void draw(Context* context)
     {
+        PROFILE_GPU_ZONE("Window::draw");
+
         auto viewport = this->getViewport();
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -114,7 +187,14 @@ public:
 
         transformation.push();
         transformation.translate(glm::vec3(-25, 15, -25));
-        m_HeightMap->draw(*context, transformation.state(), m_Camera3D.getViewMatrix(), m_Camera3D.getProjectionMatrix());
+        transformation.scale(glm::vec3(50.0f / g_HeightMapSize, 1, 50.0f / g_HeightMapSize));
+        {
+            PROFILE_GPU_ZONE("HeightMap::draw");
+            if (m_TextureHeightMap)
+                m_TextureHeightMap->draw(*context, transformation.state(), m_Camera3D.getViewMatrix(), m_Camera3D.getProjectionMatrix());
+            else
+                m_HeightMap->draw(*context, transformation.state(), m_Camera3D.getViewMatrix(), m_Camera3D.getProjectionMatrix());
+        }
         transformation.pop();
 
         glClear(GL_DEPTH_BUFFER_BIT);
@@ -122,29 +202,58 @@ public:
         transformation.push();
         transformation.translate(glm::vec3(10, 10, 0.0));
         transformation.scale(glm::vec3(10, 10, 1));
-        m_LineChart1->draw(*context, transformation.state(), m_Camera2D.getViewMatrix(), m_Camera2D.getProjectionMatrix());
+        {
+            PROFILE_GPU_ZONE("LineChart::draw");
+            m_LineChart1->draw(*context, transformation.state(), m_Camera2D.getViewMatrix(), m_Camera2D.getProjectionMatrix());
+        }
         transformation.pop();
 
         transformation.push();
         transformation.translate(glm::vec3(10, 120, 0.0));
         transformation.scale(glm::vec3(10, 10, 1));
-        m_LineChart2->draw(*context, transformation.state(), m_Camera2D.getViewMatrix(), m_Camera2D.getProjectionMatrix());
+        {
+            PROFILE_GPU_ZONE("LineChart::draw");
+            m_LineChart2->draw(*context, transformation.state(), m_Camera2D.getViewMatrix(), m_Camera2D.getProjectionMatrix());
+        }
         transformation.pop();
 
         transformation.push();
         transformation.translate(glm::vec3(10, viewport.getDimension()[1] - 10, 0.0));
         transformation.scale(glm::vec3(10, 10, 1));
-        m_IconMap->draw(*context, transformation.state(), m_Camera2D.getViewMatrix(), m_Camera2D.getProjectionMatrix());
+        {
+            PROFILE_GPU_ZONE("IconMap::draw");
+            m_IconMap->draw(*context, transformation.state(), m_Camera2D.getViewMatrix(), m_Camera2D.getProjectionMatrix());
+        }
 
         transformation.pop();
+
+        Profiler::getInstance().frame(context);
     }
 
     virtual void idle(Context* context)
     {
+        PROFILE_ZONE("Window::idle");
+
         (void) context;
 
         float t = 0.1f * static_cast<float>(m_Clock.milliseconds()) / 1000.0f;
         m_Camera3D.lookAt(glm::vec3(50 * cos(t), 25, 50 * sin(t)), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+
+        if (g_HeightMapUpdates)
+        {
+            PROFILE_ZONE("HeightMap::update");
+            MEMORY_SCOPE("Charts::HeightMap");
+
+            auto start = std::chrono::steady_clock::now();
+
+            for (unsigned int j = 0; j < 16; j++)
+                updateHeightMapRow((m_UpdateRow + j) % g_HeightMapSize, 10 * t);
+            m_UpdateRow = (m_UpdateRow + 16) % g_HeightMapSize;
+            m_UpdateBytes += updateHeightMap();
+
+            m_UpdateTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            m_Updates++;
+        }
     }
 
     inline float gaussian(float x, float mu, float sigma)
@@ -161,18 +270,40 @@ private:
     LineChart* m_LineChart1;
     LineChart* m_LineChart2;
     HeightMap* m_HeightMap;
+    TextureHeightMap* m_TextureHeightMap;
     IconMap* m_IconMap;
+
+    unsigned int m_UpdateRow;
+    unsigned long m_Updates;
+    double m_UpdateBytes;
+    double m_UpdateTime;
 };
 
 int main(int argc, char** argv)
 {
-    auto demo = new Raindance(argc, argv);
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--heightmap-texture")
+            g_TextureHeightMap = true;
+        else if (arg == "--heightmap-size" && i + 1 < argc)
+            g_HeightMapSize = std::max(2ul, strtoul(argv[++i], NULL, 10));
+        else if (arg == "--heightmap-updates")
+            g_HeightMapUpdates = true;
+    }
 
     rd::Window::Settings settings;
     settings.Title = std::string("Charts");
     settings.Width = 1024;
     settings.Height = 728;
 
+    if (benchmark.headless())
+        return benchmark.run<DemoWindow>(settings);
+
+    auto demo = new Raindance(argc, argv);
     demo->add(new DemoWindow(&settings));
     demo->run();
 
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Allocators for the frame loop.
+//
+// An Arena hands out transient memory by bumping an offset into a single block and forgets
+// all of it at once on reset(), typically at the start of every frame :
+//
+//     Entry* entries = m_Frame.allocate<Entry>(count);    // valid until the next reset()
+//
+// allocate() is lock free, so Parallel::forEach() workers can share one arena. When a frame
+// needs more than the block holds, the excess comes from the heap and the next reset() grows
+// the block to fit, so the arena stops touching the heap once it has seen the largest frame.
+//
+// Each window keeps one for its frame temporaries and resets it at the top of idle(), where
+// its frame starts. Several windows on one thread each have their own.
+//
+// Blocks, overflow and pool chunks come from the global operator new, so Benchmark's heap
+// allocation counter sees them like any other allocation.
+//
+// A Pool recycles fixed size slots for long-lived small objects (agents, graph nodes) :
+//
+//     Agent* agent = m_AgentPool.create();
+//     ...
+//     m_AgentPool.destroy(agent);
+//
+// Slots come in chunks of ChunkSize and are never returned to the heap before the pool dies.
+// Pools are not thread safe.
+
+class Arena
+{
+public:
+    Arena(size_t capacity = 64 * 1024)
+    {
+        m_Capacity = capacity;
+        m_Block = static_cast<char*>(::operator new(m_Capacity));
+        m_Offset = 0;
+        m_Overflowed = 0;
+        m_Overflow = NULL;
+        m_Peak = 0;
+        m_Grows = 0;
+    }
+
+    virtual ~Arena()
+    {
+        release();
+        ::operator delete(m_Block);
+    }
+
+    void* allocate(size_t bytes, size_t alignment = 16)
+    {
+        uintptr_t base = reinterpret_cast<uintptr_t>(m_Block);
+        size_t offset = m_Offset.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            size_t aligned = ((base + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+            if (aligned + bytes > m_Capacity)
+                return overflow(bytes, alignment);
+            if (m_Offset.compare_exchange_weak(offset, aligned + bytes, std::memory_order_relaxed))
+                return m_Block + aligned;
+        }
+    }
+
+    template <typename T>
+    inline T* allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena memory is never destroyed");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Forgets every allocation. Not thread safe, nothing may allocate while the arena resets.
+    void reset()
+    {
+        size_t used = m_Offset + m_Overflowed;
+        m_Peak = std::max(m_Peak, used);
+
+        release();
+
+        if (used > m_Capacity)
+        {
+            while (m_Capacity < used)
+                m_Capacity *= 2;
+            ::operator delete(m_Block);
+            m_Block = static_cast<char*>(::operator new(m_Capacity));
+            m_Grows++;
+        }
+
+        m_Offset = 0;
+        m_Overflowed = 0;
+    }
+
+    inline size_t used() const { return m_Offset + m_Overflowed; }
+    inline size_t capacity() const { return m_Capacity; }
+    inline size_t peak() const { return m_Peak; }
+    inline unsigned int grows() const { return m_Grows; }
+
+private:
+    // NOTE : Overflow blocks are chained through a header so tracking them doesn't allocate either.
+    struct Overflow
+    {
+        Overflow* Next;
+    };
+
+    void* overflow(size_t bytes, size_t alignment)
+    {
+        size_t header = (sizeof(Overflow) + alignment - 1) / alignment * alignment;
+        char* memory = static_cast<char*>(::operator new(header + bytes + alignment));
+
+        std::lock_guard<std::mutex> lock(m_OverflowMutex);
+        Overflow* block = reinterpret_cast<Overflow*>(memory);
+        block->Next = m_Overflow;
+        m_Overflow = block;
+        m_Overflowed += bytes + alignment;
+
+        uintptr_t address = reinterpret_cast<uintptr_t>(memory + header);
+        return reinterpret_cast<void*>((address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+    }
+
+    void release()
+    {
+        while (m_Overflow != NULL)
+        {
+            Overflow* next = m_Overflow->Next;
+            ::operator delete(m_Overflow);
+            m_Overflow = next;
+        }
+    }
+
+    char* m_Block;
+    size_t m_Capacity;
+    std::atomic<size_t> m_Offset;
+
+    std::mutex m_OverflowMutex;
+    Overflow* m_Overflow;
+    size_t m_Overflowed;
+
+    size_t m_Peak;
+    unsigned int m_Grows;
+};
+
+template <typename T, size_t ChunkSize = 256>
+class Pool
+{
+public:
+    Pool()
+    {
+        m_Free = NULL;
+        m_Live = 0;
+    }
+
+    virtual ~Pool()
+    {
+        if (m_Live > 0)
+            LOG("Pool : %lu objects still alive, their destructors won't run\n", static_cast<unsigned long>(m_Live));
+
+        for (auto chunk : m_Chunks)
+            ::operator delete(chunk);
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        if (m_Free == NULL)
+            grow();
+
+        Slot* slot = m_Free;
+        m_Free = slot->Next;
+        m_Live++;
+        return new (&slot->Storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object)
+    {
+        if (object == NULL)
+            return;
+
+        object->~T();
+
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->Next = m_Free;
+        m_Free = slot;
+        m_Live--;
+    }
+
+    inline size_t size() const { return m_Live; }
+    inline size_t capacity() const { return m_Chunks.size() * ChunkSize; }
+
+private:
+    union Slot
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+        Slot* Next;
+    };
+
+    void grow()
+    {
+        Slot* chunk = static_cast<Slot*>(::operator new(ChunkSize * sizeof(Slot)));
+        m_Chunks.push_back(chunk);
+
+        for (size_t i = ChunkSize; i > 0; i--)
+        {
+            chunk[i - 1].Next = m_Free;
+            m_Free = &chunk[i - 1];
+        }
+    }
+
+    std::vector<Slot*> m_Chunks;
+    Slot* m_Free;
+    size_t m_Live;
+};
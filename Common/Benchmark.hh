@@ -0,0 +1,510 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <dlfcn.h>
+
+#include "Memory.hh"
+#include "StateCache.hh"
+#include "StreamingBuffer.hh"
+
+#ifdef RD_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// Headless benchmark mode shared by all samples :
+//
+//     <sample> --headless [--frames N] [--warmup M] [--report file.json] [--state-cache]
+//
+// Renders into an offscreen framebuffer on a surfaceless EGL context instead of a GLFW
+// window, drives the window's idle() / draw() for M + N frames, and writes a JSON report
+// with frame time percentiles, CPU time split between idle() and draw(), GPU wait time,
+// draw call, triangle and heap allocation counts, GL state calls issued / found redundant
+// by the StateCache and tracked memory (see Memory.hh). Only the last N frames are measured.
+//
+// The GL interposers and the global operator new behind those counters are definitions, not
+// inline functions. Exactly one translation unit per executable, the sample's, defines
+// RD_BENCHMARK_IMPLEMENTATION before including this header to emit them.
+
+namespace Benchmark
+{
+    inline unsigned long& drawCalls()
+    {
+        static unsigned long count = 0;
+        return count;
+    }
+
+    inline unsigned long& triangles()
+    {
+        static unsigned long count = 0;
+        return count;
+    }
+
+    inline void countTriangles(GLenum mode, GLsizei count, GLsizei instances = 1)
+    {
+        if (mode == GL_TRIANGLES)
+            triangles() += static_cast<unsigned long>(count / 3) * instances;
+        else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2)
+            triangles() += static_cast<unsigned long>(count - 2) * instances;
+    }
+
+    inline std::atomic<unsigned long>& heapAllocations()
+    {
+        static std::atomic<unsigned long> count(0);
+        return count;
+    }
+}
+
+#ifdef RD_BENCHMARK_IMPLEMENTATION
+
+// NOTE : Draw calls are counted by interposing the GL entry points. Raindance is header
+// only, so every call made by a sample or its primitives resolves to these definitions
+// first, and they forward to the driver's through RTLD_NEXT. The instanced variants are
+// GLEW function pointers and get wrapped in Benchmark::Runner::open().
+
+#define RD_FORWARD_GL(name, type) static type next = (type) dlsym(RTLD_NEXT, #name)
+
+extern "C" void GLAPIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    typedef void (GLAPIENTRY *Function)(GLenum, GLint, GLsizei);
+    RD_FORWARD_GL(glDrawArrays, Function);
+    Benchmark::drawCalls()++;
+    Benchmark::countTriangles(mode, count);
+    next(mode, first, count);
+}
+
+extern "C" void GLAPIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices)
+{
+    typedef void (GLAPIENTRY *Function)(GLenum, GLsizei, GLenum, const GLvoid*);
+    RD_FORWARD_GL(glDrawElements, Function);
+    Benchmark::drawCalls()++;
+    Benchmark::countTriangles(mode, count);
+    next(mode, count, type, indices);
+}
+
+// NOTE : The memory hooks have to be in place before the first buffer is created, so they are
+// installed right after GLEW loads the entry points, whoever calls it.
+extern "C" GLenum GLEWAPIENTRY glewInit()
+{
+    typedef GLenum (GLEWAPIENTRY *Function)();
+    RD_FORWARD_GL(glewInit, Function);
+    GLenum status = next();
+    Memory::install();
+    StateCache::install();
+    return status;
+}
+
+#undef RD_FORWARD_GL
+
+// NOTE : Heap allocations are counted by replacing the global operator new, which every
+// container, string and primitive of the samples and the engine goes through. Allocations
+// made by the driver in C are not seen.
+void* operator new(size_t size)
+{
+    Benchmark::heapAllocations().fetch_add(1, std::memory_order_relaxed);
+    void* pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == NULL)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    Benchmark::heapAllocations().fetch_add(1, std::memory_order_relaxed);
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept
+{
+    return operator new(size, nothrow);
+}
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { free(pointer); }
+
+#endif
+
+namespace Benchmark
+{
+    struct Settings
+    {
+        Settings()
+        {
+            Headless = false;
+            Frames = 300;
+            Warmup = 30;
+        }
+
+        bool Headless;
+        unsigned int Frames;
+        unsigned int Warmup;
+        std::string Report;
+    };
+
+    struct Series
+    {
+        void push(double value) { Values.push_back(value); }
+
+        double mean() const
+        {
+            double sum = 0.0;
+            for (auto value : Values)
+                sum += value;
+            return Values.empty() ? 0.0 : sum / Values.size();
+        }
+
+        double percentile(double p) const
+        {
+            if (Values.empty())
+                return 0.0;
+            std::vector<double> sorted(Values);
+            std::sort(sorted.begin(), sorted.end());
+            size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+            return sorted[index];
+        }
+
+        std::string json() const
+        {
+            std::ostringstream out;
+            out << "{ \"mean\": " << mean()
+                << ", \"p50\": " << percentile(50)
+                << ", \"p90\": " << percentile(90)
+                << ", \"p99\": " << percentile(99)
+                << ", \"max\": " << percentile(100) << " }";
+            return out.str();
+        }
+
+        std::vector<double> Values;
+    };
+
+    typedef std::chrono::high_resolution_clock Time;
+
+    inline double milliseconds(Time::time_point start, Time::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    class Runner
+    {
+    public:
+        Runner(int argc, char** argv)
+        {
+            for (int i = 1; i < argc; i++)
+            {
+                std::string arg = argv[i];
+                if (arg == "--headless")
+                    m_Settings.Headless = true;
+                else if (arg == "--frames" && i + 1 < argc)
+                    m_Settings.Frames = strtoul(argv[++i], NULL, 10);
+                else if (arg == "--warmup" && i + 1 < argc)
+                    m_Settings.Warmup = strtoul(argv[++i], NULL, 10);
+                else if (arg == "--report" && i + 1 < argc)
+                    m_Settings.Report = argv[++i];
+                else if (arg == "--state-cache")
+                    StateCache::enabled() = true;
+            }
+
+            m_Width = 0;
+            m_Height = 0;
+            m_Framebuffer = 0;
+            m_Renderbuffers[0] = m_Renderbuffers[1] = 0;
+
+#ifdef RD_HEADLESS
+            m_Display = EGL_NO_DISPLAY;
+            m_Context = EGL_NO_CONTEXT;
+#endif
+        }
+
+        virtual ~Runner()
+        {
+            close();
+        }
+
+        inline bool headless() const { return m_Settings.Headless; }
+        inline const Settings& settings() const { return m_Settings; }
+
+        // Creates the offscreen context and framebuffer. Must be called before constructing
+        // the window, since sample constructors already issue GL calls.
+        bool open(rd::Window::Settings& settings)
+        {
+            if (settings.Width == 0 || settings.Height == 0)
+            {
+                settings.Width = 1920;
+                settings.Height = 1080;
+            }
+            settings.Fullscreen = false;
+
+            m_Title = settings.Title;
+            m_Width = settings.Width;
+            m_Height = settings.Height;
+
+#ifdef RD_HEADLESS
+            auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay)
+                m_Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            if (m_Display == EGL_NO_DISPLAY)
+                m_Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+            if (m_Display == EGL_NO_DISPLAY || !eglInitialize(m_Display, NULL, NULL))
+            {
+                LOG("Benchmark : Failed to initialize EGL display!\n");
+                return false;
+            }
+
+            eglBindAPI(EGL_OPENGL_API);
+
+            const EGLint configAttributes[] =
+            {
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                EGL_NONE
+            };
+            EGLConfig config;
+            EGLint count = 0;
+            eglChooseConfig(m_Display, configAttributes, &config, 1, &count);
+
+            const EGLint contextAttributes[] =
+            {
+                EGL_CONTEXT_MAJOR_VERSION, 3,
+                EGL_CONTEXT_MINOR_VERSION, 3,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+            };
+            m_Context = eglCreateContext(m_Display, count > 0 ? config : (EGLConfig) 0, EGL_NO_CONTEXT, contextAttributes);
+
+            if (m_Context == EGL_NO_CONTEXT || !eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_Context))
+            {
+                LOG("Benchmark : Failed to create a surfaceless OpenGL 3.3 context!\n");
+                return false;
+            }
+
+            glewExperimental = GL_TRUE;
+            GLenum status = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+            // NOTE : GLX-built GLEW loads all GL entry points before failing on the missing X display
+            if (status == GLEW_ERROR_NO_GLX_DISPLAY)
+                status = GLEW_OK;
+#endif
+            if (status != GLEW_OK)
+            {
+                LOG("Benchmark : Failed to initialize GLEW!\n");
+                return false;
+            }
+
+            hookInstancedDraws();
+            StateCache::install();
+
+            MEMORY_SCOPE("Benchmark");
+
+            glGenFramebuffers(1, &m_Framebuffer);
+            glGenRenderbuffers(2, m_Renderbuffers);
+
+            glBindRenderbuffer(GL_RENDERBUFFER, m_Renderbuffers[0]);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_Width, m_Height);
+            glBindRenderbuffer(GL_RENDERBUFFER, m_Renderbuffers[1]);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_Width, m_Height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_Renderbuffers[0]);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_Renderbuffers[1]);
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            {
+                LOG("Benchmark : Offscreen framebuffer is incomplete!\n");
+                return false;
+            }
+
+            glViewport(0, 0, m_Width, m_Height);
+            return true;
+#else
+            LOG("Benchmark : Built without EGL, headless mode is not available!\n");
+            return false;
+#endif
+        }
+
+        int run(rd::Window* window)
+        {
+#ifdef RD_HEADLESS
+            if (m_Context == EGL_NO_CONTEXT)
+                return EXIT_FAILURE;
+
+            Context context;
+
+            window->initialize(&context);
+            window->reshape(m_Width, m_Height);
+
+            Series frame, idle, draw, gpu, calls, triangles, stateCalls, stateRedundant, allocations, stall;
+
+            for (unsigned int i = 0; i < m_Settings.Warmup + m_Settings.Frames; i++)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+                drawCalls() = 0;
+                Benchmark::triangles() = 0;
+                unsigned long allocationsBefore = heapAllocations();
+                unsigned long stateCallsBefore = StateCache::counters().Calls;
+                unsigned long stateRedundantBefore = StateCache::counters().Redundant;
+
+                auto t0 = Time::now();
+                window->idle(&context);
+                auto t1 = Time::now();
+                window->draw(&context);
+                auto t2 = Time::now();
+                glFinish();
+                auto t3 = Time::now();
+                unsigned long allocationsAfter = heapAllocations();
+                double frameStall = StreamingBuffer::frameStall();
+
+                if (i < m_Settings.Warmup)
+                    continue;
+
+                frame.push(milliseconds(t0, t3));
+                idle.push(milliseconds(t0, t1));
+                draw.push(milliseconds(t1, t2));
+                gpu.push(milliseconds(t2, t3));
+                calls.push(static_cast<double>(drawCalls()));
+                triangles.push(static_cast<double>(Benchmark::triangles()));
+                allocations.push(static_cast<double>(allocationsAfter - allocationsBefore));
+                stall.push(frameStall);
+                stateCalls.push(static_cast<double>(StateCache::counters().Calls - stateCallsBefore));
+                stateRedundant.push(static_cast<double>(StateCache::counters().Redundant - stateRedundantBefore));
+            }
+
+            std::ostringstream report;
+            report << "{" << std::endl
+                   << "  \"sample\": \"" << m_Title << "\"," << std::endl
+                   << "  \"width\": " << m_Width << "," << std::endl
+                   << "  \"height\": " << m_Height << "," << std::endl
+                   << "  \"warmup\": " << m_Settings.Warmup << "," << std::endl
+                   << "  \"frames\": " << m_Settings.Frames << "," << std::endl
+                   << "  \"frame_ms\": " << frame.json() << "," << std::endl
+                   << "  \"idle_ms\": " << idle.json() << "," << std::endl
+                   << "  \"draw_ms\": " << draw.json() << "," << std::endl
+                   << "  \"gpu_wait_ms\": " << gpu.json() << "," << std::endl
+                   << "  \"draw_calls\": " << calls.json() << "," << std::endl
+                   << "  \"triangles\": " << triangles.json() << "," << std::endl
+                   << "  \"heap_allocations\": " << allocations.json() << "," << std::endl
+                   << "  \"stream_stall_ms\": " << stall.json() << "," << std::endl
+                   << "  \"state_cache\": " << (StateCache::enabled() ? "true" : "false") << "," << std::endl
+                   << "  \"state_calls\": " << stateCalls.json() << "," << std::endl
+                   << "  \"state_redundant\": " << stateRedundant.json() << "," << std::endl
+                   << "  \"state_redundant_ratio\": " << (stateCalls.mean() > 0.0 ? stateRedundant.mean() / stateCalls.mean() : 0.0) << "," << std::endl
+                   << "  \"memory_current_kb\": " << MemoryTracker::getInstance().total() / 1024.0 << "," << std::endl
+                   << "  \"memory_peak_kb\": " << MemoryTracker::getInstance().peak() / 1024.0 << std::endl
+                   << "}" << std::endl;
+
+            if (m_Settings.Report.empty())
+                std::cout << report.str();
+            else
+                std::ofstream(m_Settings.Report.c_str()) << report.str();
+
+            return EXIT_SUCCESS;
+#else
+            (void) window;
+            return EXIT_FAILURE;
+#endif
+        }
+
+        // Convenience for samples whose window only needs its settings.
+        template <typename T>
+        int run(rd::Window::Settings& settings)
+        {
+            if (!open(settings))
+                return EXIT_FAILURE;
+
+            T* window = new T(&settings);
+            int status = run(window);
+            delete window;
+
+            return status;
+        }
+
+    private:
+        void close()
+        {
+#ifdef RD_HEADLESS
+            if (m_Context != EGL_NO_CONTEXT)
+            {
+                glDeleteFramebuffers(1, &m_Framebuffer);
+                glDeleteRenderbuffers(2, m_Renderbuffers);
+
+                eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+                eglDestroyContext(m_Display, m_Context);
+                m_Context = EGL_NO_CONTEXT;
+            }
+            if (m_Display != EGL_NO_DISPLAY)
+            {
+                eglTerminate(m_Display);
+                m_Display = EGL_NO_DISPLAY;
+            }
+#endif
+        }
+
+        static PFNGLDRAWARRAYSINSTANCEDPROC& nextDrawArraysInstanced()
+        {
+            static PFNGLDRAWARRAYSINSTANCEDPROC next = NULL;
+            return next;
+        }
+
+        static PFNGLDRAWELEMENTSINSTANCEDPROC& nextDrawElementsInstanced()
+        {
+            static PFNGLDRAWELEMENTSINSTANCEDPROC next = NULL;
+            return next;
+        }
+
+        static void GLAPIENTRY countDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+        {
+            drawCalls()++;
+            countTriangles(mode, count, instances);
+            nextDrawArraysInstanced()(mode, first, count, instances);
+        }
+
+        static void GLAPIENTRY countDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices, GLsizei instances)
+        {
+            drawCalls()++;
+            countTriangles(mode, count, instances);
+            nextDrawElementsInstanced()(mode, count, type, indices, instances);
+        }
+
+        void hookInstancedDraws()
+        {
+            if (__glewDrawArraysInstanced && !nextDrawArraysInstanced())
+            {
+                nextDrawArraysInstanced() = __glewDrawArraysInstanced;
+                __glewDrawArraysInstanced = countDrawArraysInstanced;
+            }
+            if (__glewDrawElementsInstanced && !nextDrawElementsInstanced())
+            {
+                nextDrawElementsInstanced() = __glewDrawElementsInstanced;
+                __glewDrawElementsInstanced = countDrawElementsInstanced;
+            }
+        }
+
+        Settings m_Settings;
+
+        std::string m_Title;
+        int m_Width;
+        int m_Height;
+
+        GLuint m_Framebuffer;
+        GLuint m_Renderbuffers[2];
+
+#ifdef RD_HEADLESS
+        EGLDisplay m_Display;
+        EGLContext m_Context;
+#endif
+    };
+}
@@ -0,0 +1,498 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+#include "Benchmark.hh"
+#include "Profiler.hh"
+
+// Asynchronous frame capture.
+//
+//     <sample> --capture run.y4m        Raw 4:4:4 YUV4MPEG2 video, plays in ffplay / mpv, encodes with ffmpeg
+//     <sample> --capture shots/frame    PNG sequence, shots/frame_000000.png, ...
+//
+// frame() queues a glReadPixels() into the next pixel buffer of a small ring and fences it,
+// then maps whichever older buffer the GPU is done with, usually from two frames back, so
+// the read back never waits on the current frame. Pixels are handed to a writer thread that
+// converts and writes them. When the writer falls behind, frames are dropped rather than
+// slowing the render loop down. Overhead and drops are logged when the capture closes.
+//
+// The whole drawable is captured, whatever viewport the sample left set. Y4M streams play at
+// a fixed Rate : each frame lands on the tick of the time it was rendered at, the previous
+// frame is repeated over ticks left empty by drops or slow frames, and frames sharing a tick
+// with an earlier one are skipped, so playback follows wall clock time.
+
+class Capture
+{
+public:
+    enum Format
+    {
+        NONE,
+        PNG,
+        Y4M
+    };
+
+    static inline std::string& path()
+    {
+        static std::string path;
+        return path;
+    }
+
+    static void configure(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; i++)
+            if (std::string(argv[i]) == "--capture" && i + 1 < argc)
+                path() = argv[++i];
+    }
+
+    Capture()
+    {
+        const std::string& target = path();
+        if (target.empty())
+            m_Format = NONE;
+        else if (target.size() > 4 && target.compare(target.size() - 4, 4, ".y4m") == 0)
+            m_Format = Y4M;
+        else
+            m_Format = PNG;
+
+        m_Width = 0;
+        m_Height = 0;
+        m_Next = 0;
+        m_Captured = 0;
+        m_Dropped = 0;
+        m_Stalls = 0;
+        m_Ticks = 0;
+        m_Repeated = 0;
+        m_Skipped = 0;
+        m_Running = false;
+    }
+
+    virtual ~Capture()
+    {
+        if (m_Format == NONE || m_Width == 0)
+            return;
+
+        while (!m_Pending.empty())
+            collect(true);
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Running = false;
+        }
+        m_Condition.notify_all();
+        m_Writer.join();
+
+        glDeleteBuffers(Slots, m_Buffers);
+
+        LOG("Capture : %lu frames written to %s, %lu dropped, %lu stalls, overhead %s ms\n",
+            m_Captured, path().c_str(), m_Dropped, m_Stalls, m_Overhead.json().c_str());
+        if (m_Format == Y4M)
+            LOG("Capture : %lu ticks at %u fps, %lu repeated, %lu skipped\n", m_Ticks, Rate, m_Repeated, m_Skipped);
+    }
+
+    inline bool active() const { return m_Format != NONE; }
+
+    // Call at the end of draw(), reads back the framebuffer currently bound for reading.
+    void frame()
+    {
+        if (m_Format == NONE)
+            return;
+
+        PROFILE_ZONE("Capture::frame");
+        auto start = Benchmark::Time::now();
+
+        int width = 0;
+        int height = 0;
+        drawableSize(width, height);
+
+        if (m_Width == 0)
+            open(width, height);
+        else if (width != m_Width || height != m_Height)
+        {
+            // NOTE : Sizes are fixed once recording started, video streams can't change resolution.
+            m_Dropped++;
+            return;
+        }
+
+        // Ring full : the oldest read back has to be collected first, waiting if needed.
+        if (m_Pending.size() == Slots)
+            collect(true);
+
+        Slot slot;
+        slot.Buffer = m_Buffers[m_Next];
+        slot.Time = std::max(0.0, Benchmark::milliseconds(m_Start, start) / 1000.0);
+        m_Next = (m_Next + 1) % Slots;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_Pending.push_back(slot);
+
+        while (!m_Pending.empty() && collect(false))
+            ;
+
+        m_Overhead.push(Benchmark::milliseconds(start, Benchmark::Time::now()));
+    }
+
+private:
+    static const unsigned int Slots = 3;
+    static const size_t MaxQueued = 8;
+    static const unsigned int Rate = 60;
+
+    struct Slot
+    {
+        GLuint Buffer;
+        GLsync Fence;
+        double Time;
+    };
+
+    struct Frame
+    {
+        std::vector<unsigned char> Pixels;
+        double Time;
+    };
+
+    // Size of the framebuffer bound for reading, not of the viewport : split-viewport samples
+    // (stereo eyes, walls) leave only the last region set.
+    void drawableSize(int& width, int& height)
+    {
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &framebuffer);
+
+        if (framebuffer == 0)
+        {
+            GLFWwindow* window = glfwGetCurrentContext();
+            if (window != NULL)
+            {
+                glfwGetFramebufferSize(window, &width, &height);
+                return;
+            }
+        }
+        else
+        {
+            GLint type = GL_NONE;
+            GLint name = 0;
+            glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+            glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &name);
+
+            if (type == GL_RENDERBUFFER)
+            {
+                GLint bound = 0;
+                glGetIntegerv(GL_RENDERBUFFER_BINDING, &bound);
+                glBindRenderbuffer(GL_RENDERBUFFER, name);
+                glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+                glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+                glBindRenderbuffer(GL_RENDERBUFFER, bound);
+                return;
+            }
+            if (type == GL_TEXTURE)
+            {
+                GLint bound = 0;
+                glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+                glBindTexture(GL_TEXTURE_2D, name);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+                glBindTexture(GL_TEXTURE_2D, bound);
+                return;
+            }
+        }
+
+        // NOTE : No window to ask (surfaceless default framebuffer), the viewport is all there is.
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        width = viewport[2];
+        height = viewport[3];
+    }
+
+    void open(int width, int height)
+    {
+        m_Width = width;
+        m_Height = height;
+        m_Start = Benchmark::Time::now();
+        m_Ticks = 0;
+
+        glGenBuffers(Slots, m_Buffers);
+        for (unsigned int i = 0; i < Slots; i++)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, m_Buffers[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, m_Width * m_Height * 4, NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (m_Format == Y4M)
+        {
+            m_Video.open(path().c_str(), std::ios::binary);
+            m_Video << "YUV4MPEG2 W" << m_Width << " H" << m_Height << " F" << Rate << ":1 Ip A1:1 C444\n";
+        }
+
+        m_Running = true;
+        m_Writer = std::thread(&Capture::write, this);
+    }
+
+    // Maps the oldest pending read back once its fence signaled, or right away when 'wait' is set.
+    bool collect(bool wait)
+    {
+        Slot& slot = m_Pending.front();
+
+        GLenum status = glClientWaitSync(slot.Fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            if (!wait)
+                return false;
+            m_Stalls++;
+            glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(slot.Fence);
+
+        std::vector<unsigned char> pixels;
+        bool queue = false;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Queue.size() < MaxQueued)
+            {
+                queue = true;
+                if (!m_Free.empty())
+                {
+                    pixels.swap(m_Free.back());
+                    m_Free.pop_back();
+                }
+            }
+        }
+
+        if (queue)
+        {
+            pixels.resize(m_Width * m_Height * 4);
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+            void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels.size(), GL_MAP_READ_BIT);
+            if (data != NULL)
+            {
+                memcpy(pixels.data(), data, pixels.size());
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Queue.push_back(Frame());
+                m_Queue.back().Pixels.swap(pixels);
+                m_Queue.back().Time = slot.Time;
+            }
+            m_Condition.notify_one();
+        }
+        else
+            m_Dropped++;
+
+        m_Pending.pop_front();
+        return true;
+    }
+
+    void write()
+    {
+        unsigned long index = 0;
+        std::vector<unsigned char> pixels;
+        double time = 0.0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Condition.wait(lock, [&]() { return !m_Queue.empty() || !m_Running; });
+                if (m_Queue.empty())
+                    break;
+                pixels.swap(m_Queue.front().Pixels);
+                time = m_Queue.front().Time;
+                m_Queue.pop_front();
+            }
+
+            if (m_Format == Y4M)
+                writeY4M(pixels, time);
+            else
+                writePNG(pixels, index);
+            index++;
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Captured++;
+            m_Free.push_back(std::vector<unsigned char>());
+            m_Free.back().swap(pixels);
+        }
+    }
+
+    void writeY4M(const std::vector<unsigned char>& pixels, double time)
+    {
+        unsigned long tick = static_cast<unsigned long>(time * Rate + 0.5);
+        if (m_Ticks > 0 && tick < m_Ticks)
+        {
+            m_Skipped++;
+            return;
+        }
+
+        // NOTE : m_Planes still holds the previous frame, it stays on screen until this one's tick.
+        for (; m_Ticks > 0 && m_Ticks < tick; m_Ticks++, m_Repeated++)
+        {
+            m_Video << "FRAME\n";
+            m_Video.write(reinterpret_cast<const char*>(m_Planes.data()), m_Planes.size());
+        }
+
+        size_t count = m_Width * m_Height;
+        m_Planes.resize(3 * count);
+        unsigned char* y = &m_Planes[0];
+        unsigned char* u = &m_Planes[count];
+        unsigned char* v = &m_Planes[2 * count];
+
+        // NOTE : GL rows are bottom up, BT.601 studio range.
+        for (int row = 0; row < m_Height; row++)
+        {
+            const unsigned char* rgba = &pixels[(m_Height - 1 - row) * m_Width * 4];
+            size_t offset = row * m_Width;
+            for (int column = 0; column < m_Width; column++, rgba += 4)
+            {
+                int r = rgba[0], g = rgba[1], b = rgba[2];
+                y[offset + column] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                u[offset + column] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                v[offset + column] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+        }
+
+        m_Video << "FRAME\n";
+        m_Video.write(reinterpret_cast<const char*>(m_Planes.data()), m_Planes.size());
+        m_Ticks = tick + 1;
+    }
+
+    // Minimal RGBA PNG with stored (uncompressed) deflate blocks, no zlib needed.
+    void writePNG(const std::vector<unsigned char>& pixels, unsigned long index)
+    {
+        char name[1024];
+        snprintf(name, sizeof(name), "%s_%06lu.png", path().c_str(), index);
+
+        size_t stride = m_Width * 4 + 1;
+        std::vector<unsigned char> raw(stride * m_Height);
+        for (int row = 0; row < m_Height; row++)
+        {
+            raw[row * stride] = 0;
+            memcpy(&raw[row * stride + 1], &pixels[(m_Height - 1 - row) * m_Width * 4], m_Width * 4);
+        }
+
+        std::vector<unsigned char> zlib;
+        zlib.push_back(0x78);
+        zlib.push_back(0x01);
+        for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535)
+        {
+            size_t length = std::min<size_t>(65535, raw.size() - offset);
+            zlib.push_back(offset + length >= raw.size() ? 1 : 0);
+            zlib.push_back(length & 0xFF);
+            zlib.push_back((length >> 8) & 0xFF);
+            zlib.push_back(~length & 0xFF);
+            zlib.push_back((~length >> 8) & 0xFF);
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+            if (length == 0)
+                break;
+        }
+        uint32_t adler = adler32(raw);
+        for (int shift = 24; shift >= 0; shift -= 8)
+            zlib.push_back((adler >> shift) & 0xFF);
+
+        unsigned char header[13];
+        put32(header, m_Width);
+        put32(header + 4, m_Height);
+        header[8] = 8;  // bit depth
+        header[9] = 6;  // RGBA
+        header[10] = header[11] = header[12] = 0;
+
+        std::ofstream out(name, std::ios::binary);
+        static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        out.write(reinterpret_cast<const char*>(signature), 8);
+        chunk(out, "IHDR", header, sizeof(header));
+        chunk(out, "IDAT", zlib.data(), zlib.size());
+        chunk(out, "IEND", NULL, 0);
+    }
+
+    static void put32(unsigned char* out, uint32_t value)
+    {
+        out[0] = (value >> 24) & 0xFF;
+        out[1] = (value >> 16) & 0xFF;
+        out[2] = (value >> 8) & 0xFF;
+        out[3] = value & 0xFF;
+    }
+
+    static uint32_t adler32(const std::vector<unsigned char>& data)
+    {
+        uint32_t a = 1, b = 0;
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            a = (a + data[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size)
+    {
+        static uint32_t table[256] = {};
+        if (table[1] == 0)
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+    static void chunk(std::ofstream& out, const char* type, const unsigned char* data, size_t size)
+    {
+        unsigned char length[4];
+        put32(length, static_cast<uint32_t>(size));
+        out.write(reinterpret_cast<const char*>(length), 4);
+        out.write(type, 4);
+        if (size > 0)
+            out.write(reinterpret_cast<const char*>(data), size);
+
+        uint32_t crc = crc32(0xFFFFFFFFu, reinterpret_cast<const unsigned char*>(type), 4);
+        if (size > 0)
+            crc = crc32(crc, data, size);
+        unsigned char footer[4];
+        put32(footer, crc ^ 0xFFFFFFFFu);
+        out.write(reinterpret_cast<const char*>(footer), 4);
+    }
+
+    Format m_Format;
+    int m_Width;
+    int m_Height;
+
+    GLuint m_Buffers[Slots];
+    unsigned int m_Next;
+    std::deque<Slot> m_Pending;
+
+    std::thread m_Writer;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Running;
+    std::deque<Frame> m_Queue;
+    std::vector<std::vector<unsigned char>> m_Free;
+
+    std::ofstream m_Video;
+    std::vector<unsigned char> m_Planes;
+    Benchmark::Time::time_point m_Start;
+    unsigned long m_Ticks;
+    unsigned long m_Repeated;
+    unsigned long m_Skipped;
+
+    unsigned long m_Captured;
+    unsigned long m_Dropped;
+    unsigned long m_Stalls;
+    Benchmark::Series m_Overhead;
+};
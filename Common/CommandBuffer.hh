@@ -0,0 +1,346 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdint.h>
+
+#include "Arena.hh"
+#include "Uniforms.hh"
+
+// Deferred draw submission.
+//
+// A RenderQueue registers programs, geometries and render states once, on the GL thread, and
+// hands out small integer handles for them. CommandBuffers only store those handles plus plain
+// values, so any thread can record into its own buffer without touching GL :
+//
+//     commands.uniform(m_ModelMatrix, model);      // applies to the next draw
+//     commands.bindRange(*m_MaterialBlock, i);
+//     commands.draw(program, geometry, GL_TRIANGLES, 0, count);
+//
+// RenderQueue::submit() then merges the buffers, sorts draws by (state, program, geometry)
+// and replays them, binding each program, geometry and state only when it changes. Draws
+// sharing a key keep their recording order. Sort entries live in a per-submit arena, so a
+// steady stream of frames doesn't touch the heap.
+
+class CommandBuffer
+{
+public:
+    enum Type
+    {
+        INT,
+        FLOAT,
+        VEC3,
+        VEC4,
+        MAT3,
+        MAT4,
+        BUFFER_RANGE
+    };
+
+    struct Value
+    {
+        uint8_t Type;
+        GLint Location;
+        uint32_t Offset;
+    };
+
+    struct Command
+    {
+        uint64_t Key;
+        uint32_t Values;
+        uint32_t ValueCount;
+        GLenum Mode;
+        GLint First;
+        GLsizei Count;
+    };
+
+    CommandBuffer()
+    {
+        m_State = 0;
+        m_Pending = 0;
+    }
+
+    void clear()
+    {
+        m_Commands.clear();
+        m_Values.clear();
+        m_Data.clear();
+        m_State = 0;
+        m_Pending = 0;
+    }
+
+    // Render state (see RenderQueue::state()) used by the following draws.
+    inline void state(uint8_t state) { m_State = state; }
+
+    inline void uniform(const Uniforms::Location& location, int value) { push(INT, location.location(), &value, 1); }
+    inline void uniform(const Uniforms::Location& location, float value) { push(FLOAT, location.location(), &value, 1); }
+    inline void uniform(const Uniforms::Location& location, const glm::vec3& value) { push(VEC3, location.location(), glm::value_ptr(value), 3); }
+    inline void uniform(const Uniforms::Location& location, const glm::vec4& value) { push(VEC4, location.location(), glm::value_ptr(value), 4); }
+    inline void uniform(const Uniforms::Location& location, const glm::mat3& value) { push(MAT3, location.location(), glm::value_ptr(value), 9); }
+    inline void uniform(const Uniforms::Location& location, const glm::mat4& value) { push(MAT4, location.location(), glm::value_ptr(value), 16); }
+
+    template <typename T>
+    inline void bindRange(const Uniforms::Block<T>& block, size_t index)
+    {
+        float range[3];
+        GLuint buffer = block.id();
+        GLintptr offset = block.offset(index);
+        GLsizeiptr size = sizeof(T);
+
+        // NOTE : Stored bitwise in the float data, GL names and offsets fit in 32 bits.
+        uint32_t words[3] = { buffer, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) };
+        memcpy(range, words, sizeof(range));
+        push(BUFFER_RANGE, block.binding(), range, 3);
+    }
+
+    void draw(uint16_t program, uint16_t geometry, GLenum mode, GLint first, GLsizei count)
+    {
+        Command command;
+        command.Key = (static_cast<uint64_t>(m_State) << 56)
+                    | (static_cast<uint64_t>(program) << 40)
+                    | (static_cast<uint64_t>(geometry) << 24);
+        command.Values = static_cast<uint32_t>(m_Values.size() - m_Pending);
+        command.ValueCount = m_Pending;
+        command.Mode = mode;
+        command.First = first;
+        command.Count = count;
+        m_Commands.push_back(command);
+
+        m_Pending = 0;
+    }
+
+    inline const std::vector<Command>& commands() const { return m_Commands; }
+    inline const std::vector<Value>& values() const { return m_Values; }
+    inline const float* data(const Value& value) const { return &m_Data[value.Offset]; }
+
+private:
+    void push(Type type, GLint location, const float* data, size_t count)
+    {
+        Value value;
+        value.Type = static_cast<uint8_t>(type);
+        value.Location = location;
+        value.Offset = static_cast<uint32_t>(m_Data.size());
+        m_Values.push_back(value);
+        m_Data.insert(m_Data.end(), data, data + count);
+        m_Pending++;
+    }
+
+    // NOTE : Integers travel bit for bit in the float stream, one word each.
+    void push(Type type, GLint location, const int* data, size_t count)
+    {
+        static_assert(sizeof(int) == sizeof(float), "int values are stored in float words");
+
+        push(type, location, static_cast<const float*>(NULL), 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            float word;
+            memcpy(&word, &data[i], sizeof(float));
+            m_Data.push_back(word);
+        }
+    }
+
+    std::vector<Command> m_Commands;
+    std::vector<Value> m_Values;
+    std::vector<float> m_Data;
+
+    uint8_t m_State;
+    uint32_t m_Pending;
+};
+
+class RenderQueue
+{
+public:
+    struct Statistics
+    {
+        unsigned long Submits;
+        unsigned long Draws;
+        unsigned long Programs;
+        unsigned long Geometries;
+        unsigned long States;
+    };
+
+    RenderQueue()
+    {
+        // NOTE : Handle 0 is always the 'leave things as they are' state.
+        m_States.push_back(std::function<void()>());
+        m_Statistics = Statistics();
+    }
+
+    virtual ~RenderQueue()
+    {
+    }
+
+    uint16_t program(Shader::Program* shader)
+    {
+        m_Programs.push_back(shader);
+        return static_cast<uint16_t>(m_Programs.size() - 1);
+    }
+
+    uint16_t geometry(Buffer* buffer)
+    {
+        m_Geometries.push_back(buffer);
+        return static_cast<uint16_t>(m_Geometries.size() - 1);
+    }
+
+    uint8_t state(std::function<void()> apply)
+    {
+        m_States.push_back(apply);
+        return static_cast<uint8_t>(m_States.size() - 1);
+    }
+
+    inline void submit(Context* context, const std::vector<CommandBuffer*>& buffers)
+    {
+        submit(context, buffers.data(), buffers.size());
+    }
+
+    inline void submit(Context* context, CommandBuffer* buffer)
+    {
+        submit(context, &buffer, 1);
+    }
+
+    void submit(Context* context, CommandBuffer* const* buffers, size_t bufferCount)
+    {
+        m_Frame.reset();
+        m_Statistics.Submits++;
+
+        size_t count = 0;
+        for (size_t b = 0; b < bufferCount; b++)
+            count += buffers[b]->commands().size();
+
+        // NOTE : The low 24 bits of the keys are free, they hold the submission order so an
+        // unstable sort keeps draws sharing a key in order. std::stable_sort would allocate.
+        Entry* sorted = m_Frame.allocate<Entry>(count);
+        size_t order = 0;
+        for (size_t b = 0; b < bufferCount; b++)
+            for (auto& command : buffers[b]->commands())
+            {
+                Entry entry = { command.Key | (order & 0xFFFFFF), buffers[b], &command };
+                sorted[order++] = entry;
+            }
+
+        std::sort(sorted, sorted + count, [](const Entry& a, const Entry& b)
+        {
+            return a.Key < b.Key;
+        });
+
+        int state = -1;
+        int program = -1;
+        int geometry = -1;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const Entry& entry = sorted[i];
+
+            int nextState = static_cast<int>(entry.Key >> 56);
+            int nextProgram = static_cast<int>((entry.Key >> 40) & 0xFFFF);
+            int nextGeometry = static_cast<int>((entry.Key >> 24) & 0xFFFF);
+
+            if (nextState != state)
+            {
+                if (m_States[nextState])
+                    m_States[nextState]();
+                state = nextState;
+                m_Statistics.States++;
+            }
+
+            if (nextProgram != program || nextGeometry != geometry)
+            {
+                if (geometry >= 0)
+                    context->geometry().unbind(*m_Geometries[geometry]);
+
+                if (nextProgram != program)
+                {
+                    m_Programs[nextProgram]->use();
+                    m_Statistics.Programs++;
+                }
+
+                context->geometry().bind(*m_Geometries[nextGeometry], *m_Programs[nextProgram]);
+                m_Statistics.Geometries++;
+
+                program = nextProgram;
+                geometry = nextGeometry;
+            }
+
+            apply(*entry.Buffer, *entry.Command);
+
+            context->geometry().drawArrays(entry.Command->Mode, entry.Command->First, entry.Command->Count);
+            m_Statistics.Draws++;
+        }
+
+        if (geometry >= 0)
+            context->geometry().unbind(*m_Geometries[geometry]);
+    }
+
+    inline const Statistics& statistics() const { return m_Statistics; }
+
+    // Logs how many binds the sorted submission issued for its draws.
+    void dump(const char* name) const
+    {
+        if (m_Statistics.Submits == 0)
+            return;
+
+        double submits = static_cast<double>(m_Statistics.Submits);
+        LOG("%s : %lu submits, per submit %.1f draws, %.1f programs, %.1f geometries, %.1f states bound\n",
+            name, m_Statistics.Submits, m_Statistics.Draws / submits,
+            m_Statistics.Programs / submits, m_Statistics.Geometries / submits, m_Statistics.States / submits);
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t Key;
+        const CommandBuffer* Buffer;
+        const CommandBuffer::Command* Command;
+    };
+
+    void apply(const CommandBuffer& buffer, const CommandBuffer::Command& command)
+    {
+        for (uint32_t i = command.Values; i < command.Values + command.ValueCount; i++)
+        {
+            const CommandBuffer::Value& value = buffer.values()[i];
+            const float* data = buffer.data(value);
+
+            switch (value.Type)
+            {
+            case CommandBuffer::INT:
+                {
+                    int integer;
+                    memcpy(&integer, data, sizeof(int));
+                    glUniform1i(value.Location, integer);
+                }
+                break;
+            case CommandBuffer::FLOAT:
+                glUniform1f(value.Location, data[0]);
+                break;
+            case CommandBuffer::VEC3:
+                glUniform3fv(value.Location, 1, data);
+                break;
+            case CommandBuffer::VEC4:
+                glUniform4fv(value.Location, 1, data);
+                break;
+            case CommandBuffer::MAT3:
+                glUniformMatrix3fv(value.Location, 1, GL_FALSE, data);
+                break;
+            case CommandBuffer::MAT4:
+                glUniformMatrix4fv(value.Location, 1, GL_FALSE, data);
+                break;
+            case CommandBuffer::BUFFER_RANGE:
+                {
+                    uint32_t words[3];
+                    memcpy(words, data, sizeof(words));
+                    glBindBufferRange(GL_UNIFORM_BUFFER, value.Location, words[0], words[1], words[2]);
+                }
+                break;
+            }
+        }
+    }
+
+    std::vector<Shader::Program*> m_Programs;
+    std::vector<Buffer*> m_Geometries;
+    std::vector<std::function<void()>> m_States;
+
+    Arena m_Frame;
+    Statistics m_Statistics;
+};
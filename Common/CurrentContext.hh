@@ -0,0 +1,50 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#ifdef RD_HEADLESS
+#include <EGL/egl.h>
+#endif
+
+// GL state belongs to a context, and one thread may drive several of them (windows sharing
+// the main loop), so bookkeeping that mirrors GL state is kept per thread and per context.
+
+// The context current on the calling thread : the surfaceless EGL one in headless runs, the
+// GLFW window's otherwise.
+inline void* currentContext()
+{
+#ifdef RD_HEADLESS
+    EGLContext context = eglGetCurrentContext();
+    if (context != EGL_NO_CONTEXT)
+        return context;
+#endif
+    return glfwGetCurrentContext();
+}
+
+// The T kept for the current context on this thread. A context seen for the first time takes
+// the least recently added of SLOTS instances, after T::invalidate().
+template <typename T, unsigned int SLOTS = 4>
+inline T& contextLocal()
+{
+    static thread_local void* contexts[SLOTS] = {};
+    static thread_local T instances[SLOTS];
+    static thread_local unsigned int last = 0;
+    static thread_local unsigned int oldest = 0;
+
+    void* context = currentContext();
+    if (contexts[last] == context)
+        return instances[last];
+
+    for (unsigned int i = 0; i < SLOTS; i++)
+        if (contexts[i] == context)
+        {
+            last = i;
+            return instances[i];
+        }
+
+    last = oldest;
+    oldest = (oldest + 1) % SLOTS;
+    contexts[last] = context;
+    instances[last].invalidate();
+    return instances[last];
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <algorithm>
+#include <vector>
+
+// Compressed sparse row adjacency, built once from an undirected edge list.
+// Each edge appears in the neighbor lists of both of its endpoints so forces
+// can be gathered per node without any write conflicts.
+
+class CSR
+{
+public:
+    typedef std::pair<unsigned int, unsigned int> Edge;
+
+    CSR()
+    {
+    }
+
+    CSR(unsigned int nodes, const std::vector<Edge>& edges)
+    {
+        build(nodes, edges);
+    }
+
+    void build(unsigned int nodes, const std::vector<Edge>& edges)
+    {
+        m_Offsets.assign(nodes + 1, 0);
+        m_Neighbors.resize(2 * edges.size());
+
+        for (auto& edge : edges)
+        {
+            m_Offsets[edge.first + 1]++;
+            m_Offsets[edge.second + 1]++;
+        }
+
+        for (unsigned int i = 0; i < nodes; i++)
+            m_Offsets[i + 1] += m_Offsets[i];
+
+        std::vector<unsigned int> cursor(m_Offsets.begin(), m_Offsets.end() - 1);
+        for (auto& edge : edges)
+        {
+            m_Neighbors[cursor[edge.first]++] = edge.second;
+            m_Neighbors[cursor[edge.second]++] = edge.first;
+        }
+    }
+
+    inline unsigned int nodes() const { return m_Offsets.empty() ? 0 : m_Offsets.size() - 1; }
+    inline unsigned int degree(unsigned int node) const { return m_Offsets[node + 1] - m_Offsets[node]; }
+
+    inline const std::vector<unsigned int>& offsets() const { return m_Offsets; }
+    inline const std::vector<unsigned int>& neighbors() const { return m_Neighbors; }
+
+private:
+    std::vector<unsigned int> m_Offsets;
+    std::vector<unsigned int> m_Neighbors;
+};
+
+namespace Graph
+{
+    // Barabasi-Albert preferential attachment : every node after an initial clique links to
+    // 'links' distinct earlier nodes picked proportionally to their degree, which gives the
+    // power-law degree distribution (a few hubs, many leaves) of real networks.
+    inline std::vector<CSR::Edge> barabasiAlbert(unsigned int nodes, unsigned int links)
+    {
+        std::vector<CSR::Edge> edges;
+        std::vector<unsigned int> endpoints;
+
+        unsigned int seed = std::min(nodes, links + 1);
+        for (unsigned int i = 0; i < seed; i++)
+            for (unsigned int j = i + 1; j < seed; j++)
+            {
+                edges.push_back(CSR::Edge(i, j));
+                endpoints.push_back(i);
+                endpoints.push_back(j);
+            }
+
+        std::vector<unsigned int> targets;
+        for (unsigned int node = seed; node < nodes; node++)
+        {
+            // NOTE : Each endpoint appears once per incident edge, so a uniform pick is degree-proportional.
+            targets.clear();
+            while (targets.size() < links)
+            {
+                unsigned int target = endpoints[rand() % endpoints.size()];
+                if (std::find(targets.begin(), targets.end(), target) == targets.end())
+                    targets.push_back(target);
+            }
+
+            for (auto target : targets)
+            {
+                edges.push_back(CSR::Edge(node, target));
+                endpoints.push_back(node);
+                endpoints.push_back(target);
+            }
+        }
+
+        return edges;
+    }
+}
+
+namespace Layout
+{
+    // Host version of the "repulsion" kernel, O(n^2).
+    inline void repulsion(const std::vector<glm::vec4>& nodes, float k, std::vector<glm::vec4>& directions)
+    {
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            glm::vec4 f = glm::vec4(0.0);
+            for (size_t j = 0; j < nodes.size(); j++)
+            {
+                if (i == j)
+                    continue;
+                glm::vec4 direction = nodes[i] - nodes[j];
+                float magnitude = glm::length(direction);
+                if (magnitude > 0.0)
+                    f += (direction / magnitude) * (k * k / magnitude);
+            }
+            directions[i] = f;
+        }
+    }
+
+    // Host version of the per-node "attraction" kernel in Assets/particles_physics.cl.
+    inline void attraction(const std::vector<glm::vec4>& nodes, const CSR& csr, float k, std::vector<glm::vec4>& directions)
+    {
+        auto& offsets = csr.offsets();
+        auto& neighbors = csr.neighbors();
+
+        for (unsigned int i = 0; i < csr.nodes(); i++)
+        {
+            glm::vec4 f = glm::vec4(0.0);
+            for (unsigned int n = offsets[i]; n < offsets[i + 1]; n++)
+            {
+                glm::vec4 direction = nodes[i] - nodes[neighbors[n]];
+                float magnitude = glm::length(direction);
+                if (magnitude > 100.0)
+                    f -= direction * magnitude / k;
+            }
+            directions[i] += f;
+        }
+    }
+
+    // Host version of the "movement" kernel.
+    inline void movement(std::vector<glm::vec4>& nodes, const std::vector<glm::vec4>& forces, float temperature)
+    {
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            float magnitude = glm::length(forces[i]);
+            if (glm::length(nodes[i]) < 100000 && magnitude > 0.0)
+                nodes[i] += temperature * forces[i] / magnitude;
+        }
+    }
+
+    // Sequential per-edge reference, matching the former scatter kernel without its races.
+    inline void attractionReference(const std::vector<glm::vec4>& nodes, const std::vector<CSR::Edge>& edges, float k, std::vector<glm::vec4>& directions)
+    {
+        for (auto& edge : edges)
+        {
+            glm::vec4 direction = nodes[edge.first] - nodes[edge.second];
+            float magnitude = glm::length(direction);
+            if (magnitude > 100.0)
+            {
+                directions[edge.first] -= direction * magnitude / k;
+                directions[edge.second] += direction * magnitude / k;
+            }
+        }
+    }
+}
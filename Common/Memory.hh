@@ -0,0 +1,705 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <dlfcn.h>
+
+#include "CurrentContext.hh"
+
+// GPU and host memory accounting.
+//
+// Buffer, texture, renderbuffer and program allocations are recorded as they reach GL, so
+// everything the ResourceManager and the engine's primitives create is counted without them
+// knowing about it. Each allocation is charged to a category and to the owner named by the
+// innermost MEMORY_SCOPE on the allocating thread :
+//
+//     {
+//         MEMORY_SCOPE("Agents::Cylinder");
+//         m_Agent = new Cylinder(...);
+//     }
+//
+// Host side containers can be charged explicitly with track() / untrack(). Current usage and
+// high-water marks per category and per owner are available at runtime through usage() and
+// are dumped on exit. Sizes are what was requested from GL, drivers may round them up.
+//
+// Bytes sent through glBufferData() / glBufferSubData() are counted apart, uploaded() tells
+// how much a piece of code transferred by differencing it around the calls.
+//
+// GL names are only unique within a context and the contexts it shares objects with, so
+// allocations are keyed by context as well. Contexts created shared must be declared with
+// share(), Wall does it for its windows.
+
+class MemoryTracker
+{
+public:
+    enum Category
+    {
+        VERTEX_BUFFER,
+        INDEX_BUFFER,
+        UNIFORM_BUFFER,
+        PIXEL_BUFFER,
+        OTHER_BUFFER,
+        TEXTURE,
+        RENDERBUFFER,
+        PROGRAM,
+        HOST,
+        CATEGORY_COUNT
+    };
+
+    struct Usage
+    {
+        long long Current;
+        long long Peak;
+        unsigned long Allocations;
+    };
+
+    static MemoryTracker& getInstance()
+    {
+        static MemoryTracker instance;
+        return instance;
+    }
+
+    static const char* name(Category category)
+    {
+        static const char* names[CATEGORY_COUNT] =
+        {
+            "vertex buffers", "index buffers", "uniform buffers", "pixel buffers", "other buffers",
+            "textures", "renderbuffers", "programs", "host"
+        };
+        return names[category];
+    }
+
+    // Declares that 'context' shares its objects with 'root', so their names refer to the same
+    // allocations. Contexts that share nothing keep separate name spaces.
+    void share(const void* context, const void* root)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Shares.push_back(std::make_pair(context, root));
+    }
+
+    // (Re)allocates the object identified by 'key' within 'category' and the GL 'context' it
+    // was created in (NULL for host memory), replacing its previous size.
+    void allocate(Category category, const void* context, unsigned long long key, long long bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        Allocation* allocation = find(Key(category, root(context), key), true);
+        if (allocation->Bytes >= 0)
+            charge(allocation->Category, allocation->Owner, -allocation->Bytes, false);
+
+        allocation->Category = category;
+        allocation->Owner = owner(Scope::current());
+        allocation->Bytes = bytes;
+        charge(category, allocation->Owner, bytes, true);
+    }
+
+    void release(Category category, const void* context, unsigned long long key)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        erase(Key(category, root(context), key));
+    }
+
+    // Releases every key in [first, last], used for all mip levels of a texture.
+    void release(Category category, const void* context, unsigned long long first, unsigned long long last)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        const void* shared = root(context);
+        for (unsigned long long key = first; key <= last; key++)
+            erase(Key(category, shared, key));
+    }
+
+    inline void upload(long long bytes) { m_Uploaded.fetch_add(bytes, std::memory_order_relaxed); }
+    inline unsigned long long uploaded() const { return m_Uploaded.load(std::memory_order_relaxed); }
+
+    inline void track(const void* pointer, long long bytes) { allocate(HOST, NULL, reinterpret_cast<uintptr_t>(pointer), bytes); }
+    inline void untrack(const void* pointer) { release(HOST, NULL, reinterpret_cast<uintptr_t>(pointer)); }
+
+    Usage usage(Category category)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Categories[category];
+    }
+
+    Usage usage(const char* owner)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (auto& entry : m_Owners)
+            if (strcmp(entry.Name, owner) == 0)
+                return entry.Usage;
+        return Usage();
+    }
+
+    long long total()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Total.Current;
+    }
+
+    long long peak()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Total.Peak;
+    }
+
+    void dump()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        LOG("Memory : %-32s %12s %12s %8s\n", "", "current KB", "peak KB", "allocs");
+        for (int i = 0; i < CATEGORY_COUNT; i++)
+            if (m_Categories[i].Allocations > 0)
+                print(name(static_cast<Category>(i)), m_Categories[i]);
+        for (auto& entry : m_Owners)
+            print(entry.Name, entry.Usage);
+        print("total", m_Total);
+    }
+
+    class Scope
+    {
+    public:
+        Scope(const char* owner)
+        {
+            m_Previous = current();
+            current() = owner;
+        }
+
+        ~Scope()
+        {
+            current() = m_Previous;
+        }
+
+        static inline const char*& current()
+        {
+            static thread_local const char* owner = NULL;
+            return owner;
+        }
+
+    private:
+        const char* m_Previous;
+    };
+
+private:
+    struct Key
+    {
+        Key() : Group(-1), Context(NULL), Name(0) {}
+
+        // NOTE : All buffer categories share GL names, so they share a key space.
+        Key(Category category, const void* context, unsigned long long name)
+        : Group(category <= OTHER_BUFFER ? 0 : static_cast<int>(category)), Context(context), Name(name) {}
+
+        bool operator==(const Key& other) const { return Group == other.Group && Context == other.Context && Name == other.Name; }
+
+        size_t hash() const
+        {
+            uint64_t h = Name * 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(Context) * 0xC2B2AE3D27D4EB4Full ^ static_cast<uint64_t>(Group);
+            return static_cast<size_t>(h ^ (h >> 29));
+        }
+
+        int Group;
+        const void* Context;
+        unsigned long long Name;
+    };
+
+    // NOTE : Bytes < 0 marks an empty slot.
+    struct Allocation
+    {
+        Allocation() : Category(HOST), Owner(0), Bytes(-1) {}
+
+        MemoryTracker::Key Key;
+        MemoryTracker::Category Category;
+        size_t Owner;
+        long long Bytes;
+    };
+
+    struct Owner
+    {
+        const char* Name;
+        MemoryTracker::Usage Usage;
+    };
+
+    // NOTE : Allocations live in an open addressing table and owners in a reserved array, both
+    // sized up front, so steady state (re)allocations of known objects never touch the heap.
+    MemoryTracker()
+    {
+        for (int i = 0; i < CATEGORY_COUNT; i++)
+            m_Categories[i] = Usage();
+        m_Total = Usage();
+
+        m_Table.resize(4096);
+        m_Used = 0;
+        m_Uploaded = 0;
+        m_Owners.reserve(64);
+        m_Shares.reserve(16);
+    }
+
+    virtual ~MemoryTracker()
+    {
+        if (m_Total.Allocations > 0)
+            dump();
+    }
+
+    const void* root(const void* context) const
+    {
+        for (auto& share : m_Shares)
+            if (share.first == context)
+                return share.second;
+        return context;
+    }
+
+    // Returns the allocation for 'key', or when 'insert' is set a new empty one.
+    Allocation* find(const Key& key, bool insert)
+    {
+        if (insert && 2 * (m_Used + 1) > m_Table.size())
+            grow();
+
+        size_t mask = m_Table.size() - 1;
+        for (size_t i = key.hash() & mask; ; i = (i + 1) & mask)
+        {
+            Allocation& slot = m_Table[i];
+            if (slot.Bytes < 0)
+            {
+                if (!insert)
+                    return NULL;
+                slot.Key = key;
+                m_Used++;
+                return &slot;
+            }
+            if (slot.Key == key)
+                return &slot;
+        }
+    }
+
+    void erase(const Key& key)
+    {
+        Allocation* allocation = find(key, false);
+        if (allocation == NULL)
+            return;
+        charge(allocation->Category, allocation->Owner, -allocation->Bytes, false);
+
+        // NOTE : Backward shift deletion, moves later entries of the probe chain into the hole.
+        size_t mask = m_Table.size() - 1;
+        size_t hole = allocation - m_Table.data();
+        for (size_t i = (hole + 1) & mask; m_Table[i].Bytes >= 0; i = (i + 1) & mask)
+        {
+            size_t home = m_Table[i].Key.hash() & mask;
+            bool between = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+            if (!between)
+            {
+                m_Table[hole] = m_Table[i];
+                hole = i;
+            }
+        }
+        m_Table[hole] = Allocation();
+        m_Used--;
+    }
+
+    void grow()
+    {
+        std::vector<Allocation> table(m_Table.size() * 2);
+        table.swap(m_Table);
+        m_Used = 0;
+        for (auto& allocation : table)
+            if (allocation.Bytes >= 0)
+                *find(allocation.Key, true) = allocation;
+    }
+
+    size_t owner(const char* name)
+    {
+        if (name == NULL)
+            name = "(unscoped)";
+
+        // NOTE : Scopes name owners with literals, the pointer usually matches.
+        for (size_t i = 0; i < m_Owners.size(); i++)
+            if (m_Owners[i].Name == name)
+                return i;
+        for (size_t i = 0; i < m_Owners.size(); i++)
+            if (strcmp(m_Owners[i].Name, name) == 0)
+                return i;
+
+        Owner entry;
+        entry.Name = name;
+        entry.Usage = Usage();
+        m_Owners.push_back(entry);
+        return m_Owners.size() - 1;
+    }
+
+    static void add(Usage& usage, long long bytes, bool allocation)
+    {
+        usage.Current += bytes;
+        usage.Peak = std::max(usage.Peak, usage.Current);
+        if (allocation)
+            usage.Allocations++;
+    }
+
+    void charge(Category category, size_t owner, long long bytes, bool allocation)
+    {
+        add(m_Categories[category], bytes, allocation);
+        add(m_Owners[owner].Usage, bytes, allocation);
+        add(m_Total, bytes, allocation);
+    }
+
+    static void print(const char* label, const Usage& usage)
+    {
+        LOG("Memory : %-32s %12.1f %12.1f %8lu\n", label, usage.Current / 1024.0, usage.Peak / 1024.0, usage.Allocations);
+    }
+
+    std::mutex m_Mutex;
+    std::vector<Allocation> m_Table;
+    size_t m_Used;
+    Usage m_Categories[CATEGORY_COUNT];
+    std::vector<Owner> m_Owners;
+    std::vector<std::pair<const void*, const void*> > m_Shares;
+    Usage m_Total;
+    std::atomic<unsigned long long> m_Uploaded;
+};
+
+#define MEMORY_CONCAT_IMPL(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_IMPL(a, b)
+#define MEMORY_SCOPE(owner) MemoryTracker::Scope MEMORY_CONCAT(_memoryScope, __LINE__)(owner)
+
+namespace Memory
+{
+    inline GLuint bound(GLenum binding)
+    {
+        GLint name = 0;
+        glGetIntegerv(binding, &name);
+        return static_cast<GLuint>(name);
+    }
+
+    enum BufferTarget
+    {
+        ARRAY,
+        ELEMENT_ARRAY,
+        UNIFORM,
+        PIXEL_PACK,
+        PIXEL_UNPACK,
+        COPY_READ,
+        COPY_WRITE,
+        TEXTURE_BUFFER,
+        BUFFER_TARGET_COUNT,
+        UNTRACKED = BUFFER_TARGET_COUNT
+    };
+
+    inline MemoryTracker::Category category(GLenum target, GLenum* binding, BufferTarget* slot)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: *binding = GL_ARRAY_BUFFER_BINDING; *slot = ARRAY; return MemoryTracker::VERTEX_BUFFER;
+        case GL_ELEMENT_ARRAY_BUFFER: *binding = GL_ELEMENT_ARRAY_BUFFER_BINDING; *slot = ELEMENT_ARRAY; return MemoryTracker::INDEX_BUFFER;
+        case GL_UNIFORM_BUFFER: *binding = GL_UNIFORM_BUFFER_BINDING; *slot = UNIFORM; return MemoryTracker::UNIFORM_BUFFER;
+        case GL_PIXEL_PACK_BUFFER: *binding = GL_PIXEL_PACK_BUFFER_BINDING; *slot = PIXEL_PACK; return MemoryTracker::PIXEL_BUFFER;
+        case GL_PIXEL_UNPACK_BUFFER: *binding = GL_PIXEL_UNPACK_BUFFER_BINDING; *slot = PIXEL_UNPACK; return MemoryTracker::PIXEL_BUFFER;
+        case GL_COPY_READ_BUFFER: *binding = GL_COPY_READ_BUFFER_BINDING; *slot = COPY_READ; return MemoryTracker::OTHER_BUFFER;
+        case GL_COPY_WRITE_BUFFER: *binding = GL_COPY_WRITE_BUFFER_BINDING; *slot = COPY_WRITE; return MemoryTracker::OTHER_BUFFER;
+        case GL_TEXTURE_BUFFER: *binding = GL_TEXTURE_BINDING_BUFFER; *slot = TEXTURE_BUFFER; return MemoryTracker::OTHER_BUFFER;
+        default: *binding = 0; *slot = UNTRACKED; return MemoryTracker::OTHER_BUFFER;
+        }
+    }
+
+    // Buffer names bound in a context, as seen through the wrapped glBindBuffer* calls.
+    // -1 is unknown, the binding is then queried once.
+    struct Bindings
+    {
+        void invalidate()
+        {
+            std::fill(Names, Names + BUFFER_TARGET_COUNT, -1);
+        }
+
+        long long Names[BUFFER_TARGET_COUNT];
+    };
+
+    inline Bindings& bindings()
+    {
+        return contextLocal<Bindings>();
+    }
+
+    inline GLuint buffer(GLenum binding, BufferTarget slot)
+    {
+        long long& name = bindings().Names[slot];
+        if (name < 0)
+            name = bound(binding);
+        return static_cast<GLuint>(name);
+    }
+
+    inline long long texelSize(GLint format)
+    {
+        switch (format)
+        {
+        case GL_R8: case GL_RED: case GL_ALPHA: case GL_LUMINANCE: return 1;
+        case GL_RG8: case GL_R16F: case GL_LUMINANCE_ALPHA: case GL_DEPTH_COMPONENT16: return 2;
+        case GL_RGB8: case GL_RGB: return 3;
+        case GL_RG16F: case GL_R32F: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8: return 4;
+        case GL_RGBA16F: case GL_RG32F: return 8;
+        case GL_RGB32F: return 12;
+        case GL_RGBA32F: return 16;
+        default: return 4;
+        }
+    }
+
+    inline GLenum textureBinding(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_1D: return GL_TEXTURE_BINDING_1D;
+        case GL_TEXTURE_3D: return GL_TEXTURE_BINDING_3D;
+        case GL_TEXTURE_2D_ARRAY: return GL_TEXTURE_BINDING_2D_ARRAY;
+        case GL_TEXTURE_RECTANGLE: return GL_TEXTURE_BINDING_RECTANGLE;
+        case GL_TEXTURE_CUBE_MAP_POSITIVE_X: case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
+        case GL_TEXTURE_CUBE_MAP_POSITIVE_Y: case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
+        case GL_TEXTURE_CUBE_MAP_POSITIVE_Z: case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z: return GL_TEXTURE_BINDING_CUBE_MAP;
+        default: return GL_TEXTURE_BINDING_2D;
+        }
+    }
+
+    // NOTE : Texture keys are name * 256 + face * 32 + level.
+    inline unsigned long long textureKey(GLenum target, GLuint texture, GLint level)
+    {
+        unsigned long long face = 0;
+        if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+            face = target - GL_TEXTURE_CUBE_MAP_POSITIVE_X;
+        return static_cast<unsigned long long>(texture) * 256 + face * 32 + level;
+    }
+
+    struct Next
+    {
+        PFNGLBINDBUFFERPROC BindBuffer;
+        PFNGLBINDBUFFERBASEPROC BindBufferBase;
+        PFNGLBINDBUFFERRANGEPROC BindBufferRange;
+        PFNGLBINDVERTEXARRAYPROC BindVertexArray;
+        PFNGLDELETEVERTEXARRAYSPROC DeleteVertexArrays;
+        PFNGLBUFFERDATAPROC BufferData;
+        PFNGLBUFFERSUBDATAPROC BufferSubData;
+        PFNGLBUFFERSTORAGEPROC BufferStorage;
+        PFNGLDELETEBUFFERSPROC DeleteBuffers;
+        PFNGLTEXSTORAGE2DPROC TexStorage2D;
+        PFNGLRENDERBUFFERSTORAGEPROC RenderbufferStorage;
+        PFNGLDELETERENDERBUFFERSPROC DeleteRenderbuffers;
+        PFNGLLINKPROGRAMPROC LinkProgram;
+        PFNGLDELETEPROGRAMPROC DeleteProgram;
+    };
+
+    inline Next& next()
+    {
+        static Next next = {};
+        return next;
+    }
+
+    inline void bind(GLenum target, GLuint name)
+    {
+        GLenum binding;
+        BufferTarget slot;
+        category(target, &binding, &slot);
+        if (slot != UNTRACKED)
+            bindings().Names[slot] = name;
+    }
+
+    inline void GLAPIENTRY bindBuffer(GLenum target, GLuint name)
+    {
+        next().BindBuffer(target, name);
+        bind(target, name);
+    }
+
+    // NOTE : Indexed binds also bind the generic binding point.
+    inline void GLAPIENTRY bindBufferBase(GLenum target, GLuint index, GLuint name)
+    {
+        next().BindBufferBase(target, index, name);
+        bind(target, name);
+    }
+
+    inline void GLAPIENTRY bindBufferRange(GLenum target, GLuint index, GLuint name, GLintptr offset, GLsizeiptr size)
+    {
+        next().BindBufferRange(target, index, name, offset, size);
+        bind(target, name);
+    }
+
+    // NOTE : The element array binding is vertex array state.
+    inline void GLAPIENTRY bindVertexArray(GLuint name)
+    {
+        next().BindVertexArray(name);
+        bindings().Names[ELEMENT_ARRAY] = -1;
+    }
+
+    inline void GLAPIENTRY deleteVertexArrays(GLsizei count, const GLuint* names)
+    {
+        next().DeleteVertexArrays(count, names);
+        bindings().Names[ELEMENT_ARRAY] = -1;
+    }
+
+    inline void GLAPIENTRY bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+    {
+        next().BufferData(target, size, data, usage);
+
+        GLenum binding;
+        BufferTarget slot;
+        MemoryTracker::Category category = Memory::category(target, &binding, &slot);
+        if (slot != UNTRACKED)
+            MemoryTracker::getInstance().allocate(category, currentContext(), buffer(binding, slot), size);
+        if (data != NULL)
+            MemoryTracker::getInstance().upload(size);
+    }
+
+    inline void GLAPIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        next().BufferSubData(target, offset, size, data);
+        MemoryTracker::getInstance().upload(size);
+    }
+
+    inline void GLAPIENTRY bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+    {
+        next().BufferStorage(target, size, data, flags);
+
+        GLenum binding;
+        BufferTarget slot;
+        MemoryTracker::Category category = Memory::category(target, &binding, &slot);
+        if (slot != UNTRACKED)
+            MemoryTracker::getInstance().allocate(category, currentContext(), buffer(binding, slot), size);
+    }
+
+    inline void GLAPIENTRY deleteBuffers(GLsizei count, const GLuint* names)
+    {
+        // NOTE : Deleting a bound buffer unbinds it.
+        Bindings& current = bindings();
+        for (GLsizei i = 0; i < count; i++)
+        {
+            MemoryTracker::getInstance().release(MemoryTracker::VERTEX_BUFFER, currentContext(), names[i]);
+            for (unsigned int slot = 0; slot < BUFFER_TARGET_COUNT; slot++)
+                if (current.Names[slot] == names[i])
+                    current.Names[slot] = 0;
+        }
+        next().DeleteBuffers(count, names);
+    }
+
+    inline void GLAPIENTRY texStorage2D(GLenum target, GLsizei levels, GLenum format, GLsizei width, GLsizei height)
+    {
+        next().TexStorage2D(target, levels, format, width, height);
+
+        GLuint texture = bound(textureBinding(target));
+        for (GLsizei level = 0; level < levels; level++)
+        {
+            long long w = std::max(1, width >> level);
+            long long h = std::max(1, height >> level);
+            MemoryTracker::getInstance().allocate(MemoryTracker::TEXTURE, currentContext(), textureKey(target, texture, level), w * h * texelSize(format));
+        }
+    }
+
+    inline void GLAPIENTRY renderbufferStorage(GLenum target, GLenum format, GLsizei width, GLsizei height)
+    {
+        next().RenderbufferStorage(target, format, width, height);
+
+        MemoryTracker::getInstance().allocate(MemoryTracker::RENDERBUFFER, currentContext(), bound(GL_RENDERBUFFER_BINDING),
+                                              static_cast<long long>(width) * height * texelSize(format));
+    }
+
+    inline void GLAPIENTRY deleteRenderbuffers(GLsizei count, const GLuint* names)
+    {
+        for (GLsizei i = 0; i < count; i++)
+            MemoryTracker::getInstance().release(MemoryTracker::RENDERBUFFER, currentContext(), names[i]);
+        next().DeleteRenderbuffers(count, names);
+    }
+
+    // NOTE : Program memory isn't visible through GL, the binary length is the best estimate.
+    inline void GLAPIENTRY linkProgram(GLuint program)
+    {
+        next().LinkProgram(program);
+
+        GLint length = 0;
+        if (GLEW_ARB_get_program_binary)
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        MemoryTracker::getInstance().allocate(MemoryTracker::PROGRAM, currentContext(), program, length);
+    }
+
+    inline void GLAPIENTRY deleteProgram(GLuint program)
+    {
+        MemoryTracker::getInstance().release(MemoryTracker::PROGRAM, currentContext(), program);
+        next().DeleteProgram(program);
+    }
+
+    // Wraps the GLEW entry points, once they are loaded.
+    inline void install()
+    {
+        static std::atomic<bool> installed(false);
+        if (installed || __glewBufferData == NULL)
+            return;
+
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (installed)
+            return;
+
+        next().BindBuffer = __glewBindBuffer;
+        next().BindBufferBase = __glewBindBufferBase;
+        next().BindBufferRange = __glewBindBufferRange;
+        next().BindVertexArray = __glewBindVertexArray;
+        next().DeleteVertexArrays = __glewDeleteVertexArrays;
+        next().BufferData = __glewBufferData;
+        next().BufferSubData = __glewBufferSubData;
+        next().BufferStorage = __glewBufferStorage;
+        next().DeleteBuffers = __glewDeleteBuffers;
+        next().TexStorage2D = __glewTexStorage2D;
+        next().RenderbufferStorage = __glewRenderbufferStorage;
+        next().DeleteRenderbuffers = __glewDeleteRenderbuffers;
+        next().LinkProgram = __glewLinkProgram;
+        next().DeleteProgram = __glewDeleteProgram;
+
+        __glewBindBuffer = bindBuffer;
+        if (__glewBindBufferBase)
+            __glewBindBufferBase = bindBufferBase;
+        if (__glewBindBufferRange)
+            __glewBindBufferRange = bindBufferRange;
+        __glewBindVertexArray = bindVertexArray;
+        __glewDeleteVertexArrays = deleteVertexArrays;
+        __glewBufferData = bufferData;
+        __glewBufferSubData = bufferSubData;
+        if (__glewBufferStorage)
+            __glewBufferStorage = bufferStorage;
+        __glewDeleteBuffers = deleteBuffers;
+        if (__glewTexStorage2D)
+            __glewTexStorage2D = texStorage2D;
+        __glewRenderbufferStorage = renderbufferStorage;
+        __glewDeleteRenderbuffers = deleteRenderbuffers;
+        __glewLinkProgram = linkProgram;
+        __glewDeleteProgram = deleteProgram;
+
+        installed = true;
+    }
+}
+
+#ifdef RD_BENCHMARK_IMPLEMENTATION
+
+#define RD_FORWARD_GL(name, type) static type next = (type) dlsym(RTLD_NEXT, #name)
+
+extern "C" void GLAPIENTRY glTexImage2D(GLenum target, GLint level, GLint format, GLsizei width, GLsizei height, GLint border, GLenum pixelFormat, GLenum type, const GLvoid* pixels)
+{
+    typedef void (GLAPIENTRY *Function)(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const GLvoid*);
+    RD_FORWARD_GL(glTexImage2D, Function);
+    next(target, level, format, width, height, border, pixelFormat, type, pixels);
+
+    if (target == GL_PROXY_TEXTURE_2D || target == GL_PROXY_TEXTURE_CUBE_MAP)
+        return;
+
+    GLuint texture = Memory::bound(Memory::textureBinding(target));
+    MemoryTracker::getInstance().allocate(MemoryTracker::TEXTURE, currentContext(), Memory::textureKey(target, texture, level),
+                                          static_cast<long long>(width) * height * Memory::texelSize(format));
+}
+
+extern "C" void GLAPIENTRY glDeleteTextures(GLsizei count, const GLuint* textures)
+{
+    typedef void (GLAPIENTRY *Function)(GLsizei, const GLuint*);
+    RD_FORWARD_GL(glDeleteTextures, Function);
+
+    for (GLsizei i = 0; i < count; i++)
+        MemoryTracker::getInstance().release(MemoryTracker::TEXTURE, currentContext(), textures[i] * 256ull, textures[i] * 256ull + 255);
+    next(count, textures);
+}
+
+#undef RD_FORWARD_GL
+
+#endif
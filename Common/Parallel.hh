@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace Parallel
+{
+    inline unsigned int concurrency()
+    {
+        unsigned int count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : count;
+    }
+
+    // Persistent worker threads, started on first use. A job is a plain function pointer and
+    // context, so handing one out doesn't touch the heap.
+    class Workers
+    {
+    public:
+        typedef void (*Task)(void* context, size_t begin, size_t end);
+
+        static Workers& getInstance()
+        {
+            static Workers instance;
+            return instance;
+        }
+
+        // Runs task on every 'chunk' sized range of [0, count), the calling thread included.
+        // Returns false without running anything when the workers are already busy (nested or
+        // concurrent calls from another window's thread), the caller then runs the job itself.
+        bool run(Task task, void* context, size_t count, size_t chunk)
+        {
+            if (worker())
+                return false;
+
+            std::unique_lock<std::mutex> busy(m_Busy, std::try_to_lock);
+            if (!busy.owns_lock())
+                return false;
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Job.Task = task;
+                m_Job.Context = context;
+                m_Job.Count = count;
+                m_Job.Chunk = chunk;
+                m_Next = 0;
+                m_Open = true;
+                m_Generation++;
+            }
+            m_Wake.notify_all();
+
+            execute(m_Job);
+
+            // NOTE : Every chunk is claimed at this point, wait for the ones still running.
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Open = false;
+            m_Done.wait(lock, [this]() { return m_Active == 0; });
+            return true;
+        }
+
+    private:
+        struct Job
+        {
+            Workers::Task Task;
+            void* Context;
+            size_t Count;
+            size_t Chunk;
+        };
+
+        Workers()
+        {
+            m_Job = Job();
+            m_Next = 0;
+            m_Generation = 0;
+            m_Active = 0;
+            m_Open = false;
+            m_Stop = false;
+
+            for (unsigned int i = 1; i < concurrency(); i++)
+                m_Threads.push_back(std::thread(&Workers::loop, this));
+        }
+
+        virtual ~Workers()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stop = true;
+            }
+            m_Wake.notify_all();
+
+            for (auto& thread : m_Threads)
+                thread.join();
+        }
+
+        static inline bool& worker()
+        {
+            static thread_local bool worker = false;
+            return worker;
+        }
+
+        void execute(const Job& job)
+        {
+            for (;;)
+            {
+                size_t begin = m_Next.fetch_add(1) * job.Chunk;
+                if (begin >= job.Count)
+                    return;
+                job.Task(job.Context, begin, std::min(begin + job.Chunk, job.Count));
+            }
+        }
+
+        void loop()
+        {
+            worker() = true;
+
+            unsigned long generation = 0;
+            for (;;)
+            {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(m_Mutex);
+                    m_Wake.wait(lock, [&]() { return m_Stop || m_Generation != generation; });
+                    if (m_Stop)
+                        return;
+
+                    generation = m_Generation;
+                    if (!m_Open)
+                        continue;
+
+                    m_Active++;
+                    job = m_Job;
+                }
+
+                execute(job);
+
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (--m_Active == 0)
+                    m_Done.notify_all();
+            }
+        }
+
+        std::vector<std::thread> m_Threads;
+
+        std::mutex m_Busy;
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::condition_variable m_Done;
+
+        Job m_Job;
+        std::atomic<size_t> m_Next;
+        unsigned long m_Generation;
+        unsigned int m_Active;
+        bool m_Open;
+        bool m_Stop;
+    };
+
+    // Splits [0, count) into contiguous chunks, one per hardware thread, and calls
+    // function(begin, end) on each. The calling thread takes part in the work.
+    // Chunk boundaries are multiples of 'grain' so vectorized loops stay aligned.
+    template <typename Function>
+    void forEach(size_t count, Function function, size_t grain = 64)
+    {
+        size_t threads = std::min<size_t>(concurrency(), (count + grain - 1) / grain);
+        if (threads <= 1)
+        {
+            function(static_cast<size_t>(0), count);
+            return;
+        }
+
+        size_t chunk = (count + threads - 1) / threads;
+        chunk = (chunk + grain - 1) / grain * grain;
+
+        struct Call
+        {
+            static void run(void* context, size_t begin, size_t end)
+            {
+                (*static_cast<Function*>(context))(begin, end);
+            }
+        };
+
+        if (!Workers::getInstance().run(&Call::run, &function, count, chunk))
+            function(static_cast<size_t>(0), count);
+    }
+}
@@ -0,0 +1,436 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+#include <raindance/Core/Camera/Camera.hh>
+#include <raindance/Core/Transformation.hh>
+#include <raindance/Core/Text.hh>
+#include <raindance/Core/Font.hh>
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+// Scoped CPU / GPU instrumentation zones.
+//
+//     PROFILE_ZONE("Agents::idle");         // CPU time only
+//     PROFILE_GPU_ZONE("Grid::draw");       // CPU time + GL timestamp queries
+//
+// Zones cost a single branch while the profiler is disabled. When enabled, CPU zones go to
+// per-thread buffers and GPU zones issue two glQueryCounter() calls whose results are read
+// back by frame() once available, usually a few frames later, so nothing stalls.
+//
+// frame() drains the buffers, so memory stays bounded however long the run : zones are
+// appended to the trace file as they are collected, and a thread recording more than
+// MaxEvents zones between two frames drops the excess (counted, and reported on exit).
+//
+// Samples enable it from the command line through Profiler::configure() :
+//
+//     --profile trace.json     Streams all zones as Chrome trace JSON (chrome://tracing)
+//     --profile-overlay        Draws per-zone CPU / GPU milliseconds over the frame
+
+class Profiler
+{
+public:
+    struct Event
+    {
+        const char* Name;
+        double Begin;
+        double Duration;
+    };
+
+    struct ThreadBuffer
+    {
+        unsigned int ID;
+        std::mutex Mutex;
+        std::vector<Event> Events;
+        unsigned long Dropped;
+    };
+
+    struct Query
+    {
+        const char* Name;
+        GLuint Begin;
+        GLuint End;
+        unsigned long Frame;
+    };
+
+    struct Totals
+    {
+        double CPU;
+        double GPU;
+    };
+
+    static Profiler& getInstance()
+    {
+        static Profiler instance;
+        return instance;
+    }
+
+    static inline bool& enabled()
+    {
+        static bool enabled = false;
+        return enabled;
+    }
+
+    // GL query objects belong to a single context. Cleared when windows render on separate
+    // contexts, GPU zones then only record their CPU side.
+    static inline bool& gpu()
+    {
+        static bool gpu = true;
+        return gpu;
+    }
+
+    void configure(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--profile" && i + 1 < argc)
+                m_TracePath = argv[++i];
+            else if (arg == "--profile-overlay")
+                m_Overlay = true;
+        }
+
+        if (!m_TracePath.empty())
+        {
+            m_Trace.open(m_TracePath.c_str());
+            m_Trace << "{ \"traceEvents\": [" << std::endl;
+        }
+
+        enabled() = !m_TracePath.empty() || m_Overlay;
+    }
+
+    inline double now() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_Epoch).count();
+    }
+
+    void record(const char* name, double begin, double end)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.Mutex);
+        if (buffer.Events.size() >= MaxEvents)
+        {
+            buffer.Dropped++;
+            return;
+        }
+        Event event = { name, begin, end - begin };
+        buffer.Events.push_back(event);
+    }
+
+    Query beginQuery(const char* name)
+    {
+        Query query;
+        query.Name = name;
+        query.Begin = allocateQuery();
+        query.End = 0;
+        query.Frame = m_Frame;
+        glQueryCounter(query.Begin, GL_TIMESTAMP);
+        return query;
+    }
+
+    void endQuery(Query& query)
+    {
+        query.End = allocateQuery();
+        glQueryCounter(query.End, GL_TIMESTAMP);
+        m_PendingQueries.push_back(query);
+    }
+
+    // Ends the current frame : resolves GPU queries whose results are available, folds this
+    // frame's zones into the overlay totals and draws the overlay if requested.
+    void frame(Context* context)
+    {
+        if (!enabled())
+            return;
+
+        std::lock_guard<std::mutex> lock(m_FrameMutex);
+
+        resolveQueries();
+        collect();
+
+        if (m_Overlay)
+            drawOverlay(context);
+
+        m_Frame++;
+
+        // NOTE : The stream buffers on its own, this bounds what a crash loses.
+        if (m_Trace.is_open() && m_Frame % TraceFlushInterval == 0)
+            m_Trace.flush();
+    }
+
+    inline const std::map<std::string, Totals>& totals() const { return m_Totals; }
+
+    class Zone
+    {
+    public:
+        Zone(const char* name, bool gpu = false)
+        {
+            m_Active = Profiler::enabled();
+            if (!m_Active)
+                return;
+
+            m_Name = name;
+            m_GPU = gpu && Profiler::gpu();
+            if (m_GPU)
+                m_Query = Profiler::getInstance().beginQuery(name);
+            m_Begin = Profiler::getInstance().now();
+        }
+
+        ~Zone()
+        {
+            if (!m_Active)
+                return;
+
+            Profiler& profiler = Profiler::getInstance();
+            profiler.record(m_Name, m_Begin, profiler.now());
+            if (m_GPU)
+                profiler.endQuery(m_Query);
+        }
+
+    private:
+        bool m_Active;
+        bool m_GPU;
+        const char* m_Name;
+        double m_Begin;
+        Query m_Query;
+    };
+
+private:
+    static const unsigned int GPUThread = 1000;
+    static const size_t MaxEvents = 65536;
+    static const unsigned long TraceFlushInterval = 300;
+    static const unsigned long OverlayInterval = 30;
+
+    Profiler()
+    {
+        m_Epoch = std::chrono::steady_clock::now();
+        m_Overlay = false;
+        m_Frame = 0;
+        m_NextThread = 0;
+        m_GPUOffset = 0.0;
+        m_Calibrated = false;
+        m_GPUFrame = 0;
+        m_FirstEvent = true;
+        m_Font = NULL;
+    }
+
+    virtual ~Profiler()
+    {
+        if (m_Trace.is_open())
+        {
+            // NOTE : Zones recorded after the last frame(), or by samples that never call it.
+            collect();
+
+            m_Trace << "], \"otherData\": { \"gpu_tid\": " << GPUThread << " } }" << std::endl;
+            m_Trace.close();
+            LOG("Profiler : %lu frames written to %s\n", m_Frame, m_TracePath.c_str());
+        }
+
+        unsigned long dropped = 0;
+        for (auto buffer : m_Buffers)
+        {
+            dropped += buffer->Dropped;
+            delete buffer;
+        }
+        if (dropped > 0)
+            LOG("Profiler : %lu zones dropped, more than %lu per thread between frames\n", dropped, static_cast<unsigned long>(MaxEvents));
+
+        // NOTE : GL objects (queries, font, overlay text) are intentionally leaked, the context is gone by now.
+    }
+
+    ThreadBuffer& threadBuffer()
+    {
+        // NOTE : Buffers outlive their thread so zones recorded by short-lived workers still get exported.
+        static thread_local ThreadBuffer* buffer = NULL;
+        if (buffer == NULL)
+        {
+            buffer = new ThreadBuffer();
+            buffer->Dropped = 0;
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            buffer->ID = m_NextThread++;
+            m_Buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    GLuint allocateQuery()
+    {
+        if (m_FreeQueries.empty())
+        {
+            GLuint queries[64];
+            glGenQueries(64, queries);
+            m_FreeQueries.insert(m_FreeQueries.end(), queries, queries + 64);
+        }
+
+        GLuint query = m_FreeQueries.back();
+        m_FreeQueries.pop_back();
+        return query;
+    }
+
+    void resolveQueries()
+    {
+        if (!m_Calibrated)
+        {
+            GLint64 timestamp = 0;
+            glGetInteger64v(GL_TIMESTAMP, &timestamp);
+            m_GPUOffset = now() - timestamp / 1000.0;
+            m_Calibrated = true;
+        }
+
+        // Queries complete in submission order, stop at the first one still in flight.
+        size_t resolved = 0;
+        for (auto& query : m_PendingQueries)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(query.End, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(query.Begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(query.End, GL_QUERY_RESULT, &end);
+
+            Event event = { query.Name, begin / 1000.0 + m_GPUOffset, (end - begin) / 1000.0 };
+            if (m_Trace.is_open())
+                write(event, GPUThread);
+
+            if (query.Frame != m_GPUFrame)
+            {
+                for (auto& total : m_Totals)
+                    total.second.GPU = 0.0;
+                for (auto& accumulated : m_GPUAccumulated)
+                    m_Totals[accumulated.first].GPU = accumulated.second;
+                m_GPUAccumulated.clear();
+                m_GPUFrame = query.Frame;
+            }
+            m_GPUAccumulated[query.Name] += event.Duration / 1000.0;
+
+            m_FreeQueries.push_back(query.Begin);
+            m_FreeQueries.push_back(query.End);
+            resolved++;
+        }
+        m_PendingQueries.erase(m_PendingQueries.begin(), m_PendingQueries.begin() + resolved);
+    }
+
+    void collect()
+    {
+        for (auto& total : m_Totals)
+            total.second.CPU = 0.0;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (auto buffer : m_Buffers)
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->Mutex);
+            for (auto& event : buffer->Events)
+            {
+                m_Totals[event.Name].CPU += event.Duration / 1000.0;
+                if (m_Trace.is_open())
+                    write(event, buffer->ID);
+            }
+            buffer->Events.clear();
+        }
+    }
+
+    void write(const Event& event, unsigned int tid)
+    {
+        m_Trace << (m_FirstEvent ? "  " : ", ")
+                << "{ \"name\": \"" << event.Name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << tid
+                << ", \"ts\": " << event.Begin << ", \"dur\": " << event.Duration << " }" << std::endl;
+        m_FirstEvent = false;
+    }
+
+    void drawOverlay(Context* context)
+    {
+        if (m_Font == NULL)
+            m_Font = new rd::Font();
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        Camera camera;
+        camera.setOrthographicProjection(0, viewport[2], 0, viewport[3], -10, 10);
+        camera.lookAt(glm::vec3(0, 0, 1), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+
+        // NOTE : Numbers refresh a few times per second, a line's Text is only rebuilt when it reads differently.
+        if (m_Frame % OverlayInterval == 0 || m_Lines.size() < m_Totals.size())
+        {
+            size_t index = 0;
+            for (auto& total : m_Totals)
+            {
+                char line[256];
+                snprintf(line, sizeof(line), "%-32s cpu %7.3f ms   gpu %7.3f ms", total.first.c_str(), total.second.CPU, total.second.GPU);
+
+                if (index == m_Lines.size())
+                {
+                    m_Lines.push_back(new Text());
+                    m_Lines.back()->setColor(glm::vec4(1.0, 1.0, 0.5, 1.0));
+                    m_LineStrings.push_back(std::string());
+                }
+                if (m_LineStrings[index] != line)
+                {
+                    m_LineStrings[index] = line;
+                    m_Lines[index]->set(line, m_Font);
+                }
+                index++;
+            }
+        }
+
+        GLboolean depth = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        GLint blendFunc[4];
+        glGetIntegerv(GL_BLEND_SRC_RGB, &blendFunc[0]);
+        glGetIntegerv(GL_BLEND_DST_RGB, &blendFunc[1]);
+        glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendFunc[2]);
+        glGetIntegerv(GL_BLEND_DST_ALPHA, &blendFunc[3]);
+
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        Transformation transformation;
+        transformation.translate(glm::vec3(10, viewport[3] - 10 - m_Font->getSize(), 0));
+
+        for (auto text : m_Lines)
+        {
+            text->draw(*context, camera.getProjectionMatrix() * camera.getViewMatrix() * transformation.state());
+            transformation.translate(glm::vec3(0, -m_Font->getSize(), 0));
+        }
+
+        glBlendFuncSeparate(blendFunc[0], blendFunc[1], blendFunc[2], blendFunc[3]);
+        if (depth) glEnable(GL_DEPTH_TEST);
+        if (!blend) glDisable(GL_BLEND);
+    }
+
+    std::chrono::steady_clock::time_point m_Epoch;
+    std::string m_TracePath;
+    std::ofstream m_Trace;
+    bool m_FirstEvent;
+    bool m_Overlay;
+    unsigned long m_Frame;
+    std::mutex m_FrameMutex;
+
+    std::mutex m_Mutex;
+    std::vector<ThreadBuffer*> m_Buffers;
+    unsigned int m_NextThread;
+
+    std::vector<GLuint> m_FreeQueries;
+    std::vector<Query> m_PendingQueries;
+    double m_GPUOffset;
+    bool m_Calibrated;
+    unsigned long m_GPUFrame;
+    std::map<std::string, double> m_GPUAccumulated;
+
+    std::map<std::string, Totals> m_Totals;
+    rd::Font* m_Font;
+    std::vector<Text*> m_Lines;
+    std::vector<std::string> m_LineStrings;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(_profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) Profiler::Zone PROFILE_CONCAT(_profileZone, __LINE__)(name, true)
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <vector>
+
+// On-demand redraw for windows whose content only changes on input, data or timers.
+//
+// The run loop calls idle() then draw() as fast as it can. A window owning a Redraw calls
+// wait() at the top of idle() : when nothing marked it dirty, the loop thread sleeps in
+// glfwWaitEvents() until an input event, an invalidate() from any thread or the next
+// scheduled animation tick, so a static window only draws once per event.
+//
+//     onKey / reshape / data arrival    ->  redraw.invalidate();
+//     animation                         ->  redraw.schedule(1.0 / 60.0);
+//
+// Pass --continuous to get the original busy loop back. Headless benchmark runs have no
+// GLFW context and are never throttled.
+//
+// Windows sharing the main loop thread wait together : the first one to call wait() in a
+// loop iteration blocks until any of them is dirty, receives an event or reaches its next
+// scheduled tick, and the others go straight through in that iteration.
+//
+// When windows render on their own threads (see Wall), threaded() is set and wait() blocks
+// on a condition variable instead, since only the main thread may wait for GLFW events.
+
+class Redraw
+{
+public:
+    Redraw()
+    {
+        m_Dirty = true;
+        m_Interactive = false;
+        m_Deadline = -1.0;
+        m_Frames = 0;
+        m_Start = std::chrono::steady_clock::now();
+        m_StartCPU = std::clock();
+
+        std::lock_guard<std::mutex> lock(mutex());
+        windows().push_back(this);
+    }
+
+    virtual ~Redraw()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            windows().erase(std::find(windows().begin(), windows().end(), this));
+        }
+
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count();
+        double cpu = static_cast<double>(std::clock() - m_StartCPU) / CLOCKS_PER_SEC;
+
+        if (wall > 0.0)
+            LOG("Redraw : %lu frames in %.1f s (%.2f fps), CPU %.1f%%\n", m_Frames, wall, m_Frames / wall, 100.0 * cpu / wall);
+    }
+
+    static inline bool& continuous()
+    {
+        static bool continuous = false;
+        return continuous;
+    }
+
+    static inline bool& threaded()
+    {
+        static bool threaded = false;
+        return threaded;
+    }
+
+    // Releases every waiting window once, whether dirty or not. Used for resizes.
+    static void wakeAll()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            generation()++;
+        }
+        condition().notify_all();
+    }
+
+    // Releases every waiting window for good, wait() no longer blocks afterwards.
+    static void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            stopped() = true;
+        }
+        condition().notify_all();
+    }
+
+    static void configure(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; i++)
+            if (std::string(argv[i]) == "--continuous")
+                continuous() = true;
+    }
+
+    // Thread safe, wakes up the loop if it is currently waiting.
+    void invalidate()
+    {
+        if (threaded())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex());
+                m_Dirty = true;
+            }
+            condition().notify_all();
+        }
+        else
+        {
+            m_Dirty = true;
+            if (m_Interactive)
+                glfwPostEmptyEvent();
+        }
+    }
+
+    // Requests a redraw 'seconds' from now, earliest request wins.
+    void schedule(double seconds)
+    {
+        double deadline = glfwGetTime() + seconds;
+        if (m_Deadline < 0.0 || deadline < m_Deadline)
+            m_Deadline = deadline;
+    }
+
+    void wait()
+    {
+        m_Frames++;
+
+        if (continuous() || glfwGetCurrentContext() == NULL)
+            return;
+        m_Interactive = true;
+
+        if (threaded())
+            waitCondition();
+        else if (round()++ % windows().size() == 0)
+            waitEvents();
+
+        m_Dirty = false;
+        if (m_Deadline >= 0.0 && glfwGetTime() >= m_Deadline)
+            m_Deadline = -1.0;
+    }
+
+    inline unsigned long frames() const { return m_Frames; }
+
+private:
+    static std::mutex& mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::condition_variable& condition()
+    {
+        static std::condition_variable condition;
+        return condition;
+    }
+
+    static unsigned long& generation()
+    {
+        static unsigned long generation = 0;
+        return generation;
+    }
+
+    static bool& stopped()
+    {
+        static bool stopped = false;
+        return stopped;
+    }
+
+    static std::vector<Redraw*>& windows()
+    {
+        static std::vector<Redraw*> windows;
+        return windows;
+    }
+
+    // NOTE : Counts wait() calls on the main loop thread, the loop calls idle() on every window
+    // in the same order so a multiple of the window count starts a new iteration.
+    static unsigned long& round()
+    {
+        static unsigned long round = 0;
+        return round;
+    }
+
+    // Blocks the main loop thread once for all the windows it drives.
+    static void waitEvents()
+    {
+        bool dirty = false;
+        double deadline = -1.0;
+        for (auto redraw : windows())
+        {
+            dirty = redraw->m_Dirty.exchange(false) || dirty;
+            if (redraw->m_Deadline >= 0.0 && (deadline < 0.0 || redraw->m_Deadline < deadline))
+                deadline = redraw->m_Deadline;
+        }
+
+        if (dirty)
+            return;
+
+        if (deadline < 0.0)
+            glfwWaitEvents();
+        else
+        {
+            double timeout = deadline - glfwGetTime();
+            if (timeout > 0.0)
+                glfwWaitEventsTimeout(timeout);
+        }
+    }
+
+    void waitCondition()
+    {
+        std::unique_lock<std::mutex> lock(mutex());
+
+        unsigned long seen = generation();
+        auto ready = [&]() { return m_Dirty || generation() != seen || stopped(); };
+
+        if (m_Deadline < 0.0)
+            condition().wait(lock, ready);
+        else
+        {
+            double timeout = m_Deadline - glfwGetTime();
+            if (timeout > 0.0)
+                condition().wait_for(lock, std::chrono::duration<double>(timeout), ready);
+        }
+    }
+
+    std::atomic<bool> m_Dirty;
+    std::atomic<bool> m_Interactive;
+    double m_Deadline;
+    unsigned long m_Frames;
+
+    std::chrono::steady_clock::time_point m_Start;
+    std::clock_t m_StartCPU;
+};
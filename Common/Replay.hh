@@ -0,0 +1,271 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Deterministic record / replay of simulation input.
+//
+//     <sample> --record run.rdr [--seed N]     Runs normally and logs the seed, every tick and every input
+//     <sample> --replay run.rdr                Seeds RANDOM_FLOAT and drives idle() from the log
+//
+// Samples route their clock and external inputs through the replay :
+//
+//     float t = Replay::getInstance().tick(m_Clock.seconds());    // real time, or the logged one
+//     Replay::getInstance().input(value);                          // recorded, or replaced by the logged one
+//
+// tick() returns the simulation time for this frame. While recording it is the real time and
+// is appended to the log as is, while replaying the logged value is returned bit for bit, so
+// every comparison against it lands on the same side and the simulation goes through exactly
+// the same steps whatever the actual frame rate. Inputs
+// are values received from outside (keys, shared memory samples, ...) : recorded with the
+// tick they arrived in, and handed back in the same ticks and order on replay.
+//
+// The log is a small header (magic, version, seed) followed by one record per tick or input,
+// a tick is 5 bytes. Meant for a single window per process.
+
+class Replay
+{
+public:
+    enum Mode
+    {
+        OFF,
+        RECORD,
+        REPLAY
+    };
+
+    static Replay& getInstance()
+    {
+        static Replay instance;
+        return instance;
+    }
+
+    void configure(int argc, char** argv)
+    {
+        std::string path;
+        bool seeded = false;
+
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--record" && i + 1 < argc)
+            {
+                m_Mode = RECORD;
+                path = argv[++i];
+            }
+            else if (arg == "--replay" && i + 1 < argc)
+            {
+                m_Mode = REPLAY;
+                path = argv[++i];
+            }
+            else if (arg == "--seed" && i + 1 < argc)
+            {
+                m_Seed = static_cast<uint32_t>(strtoul(argv[++i], NULL, 10));
+                seeded = true;
+            }
+        }
+
+        if (m_Mode == RECORD)
+        {
+            if (!seeded)
+                m_Seed = static_cast<uint32_t>(time(NULL));
+
+            m_File = fopen(path.c_str(), "wb");
+            if (m_File == NULL)
+            {
+                LOG("Replay : Failed to open %s for writing!\n", path.c_str());
+                m_Mode = OFF;
+                return;
+            }
+
+            uint32_t header[3] = { Magic, Version, m_Seed };
+            fwrite(header, sizeof(header), 1, m_File);
+            LOG("Replay : Recording to %s, seed %u\n", path.c_str(), m_Seed);
+        }
+        else if (m_Mode == REPLAY)
+        {
+            if (!load(path))
+            {
+                m_Mode = OFF;
+                return;
+            }
+            LOG("Replay : Replaying %s, seed %u, %lu ticks\n", path.c_str(), m_Seed, m_Ticks);
+        }
+
+        if (m_Mode != OFF || seeded)
+            srand(m_Seed);
+    }
+
+    inline Mode mode() const { return m_Mode; }
+    inline uint32_t seed() const { return m_Seed; }
+
+    // Starts a new tick and returns its simulation time, in seconds.
+    float tick(float now)
+    {
+        switch (m_Mode)
+        {
+        case RECORD:
+            write(TICK, &now, sizeof(now));
+            m_Time = now;
+            break;
+        case REPLAY:
+            {
+                // NOTE : Skip inputs nobody asked for during the previous tick.
+                while (m_Cursor < m_Log.size() && m_Log[m_Cursor] == INPUT)
+                    m_Cursor += 2 + m_Log[m_Cursor + 1];
+
+                if (m_Cursor < m_Log.size())
+                {
+                    float time;
+                    memcpy(&time, &m_Log[m_Cursor + 1], sizeof(time));
+                    m_Cursor += 1 + sizeof(time);
+                    m_LastDelta = m_Tick == 0 ? 0.0f : time - m_Time;
+                    m_Time = time;
+                }
+                else
+                {
+                    // NOTE : Past the end nothing was recorded to match, keep stepping at the last rate.
+                    if (!m_Exhausted)
+                    {
+                        LOG("Replay : Log exhausted after %lu ticks, continuing at the last step\n", m_Tick);
+                        m_Exhausted = true;
+                    }
+                    m_Time += m_LastDelta;
+                }
+            }
+            break;
+        default:
+            m_Time = now;
+            break;
+        }
+
+        m_Tick++;
+        return m_Time;
+    }
+
+    // Records an input received during the current tick, or while replaying, overwrites it with
+    // the next one logged for this tick. Returns false when the log has nothing more for this
+    // tick, the caller should then stop consuming inputs until the next one.
+    template <typename T>
+    bool input(T& value)
+    {
+        static_assert(sizeof(T) <= 255, "Inputs are limited to 255 bytes");
+
+        if (m_Mode == RECORD)
+            write(INPUT, &value, sizeof(T));
+        else if (m_Mode == REPLAY)
+        {
+            if (m_Cursor >= m_Log.size() || m_Log[m_Cursor] != INPUT)
+                return false;
+
+            uint8_t size = m_Log[m_Cursor + 1];
+            if (size == sizeof(T))
+                memcpy(&value, &m_Log[m_Cursor + 2], sizeof(T));
+            m_Cursor += 2 + size;
+            return size == sizeof(T);
+        }
+        return true;
+    }
+
+    // Whether inputs come from the log rather than from their actual source.
+    inline bool replaying() const { return m_Mode == REPLAY; }
+
+private:
+    enum Record
+    {
+        TICK = 0,
+        INPUT = 1
+    };
+
+    static const uint32_t Magic = 0x50524452; // 'RDRP'
+    static const uint32_t Version = 2;
+
+    Replay()
+    {
+        m_Mode = OFF;
+        m_Seed = 0;
+        m_File = NULL;
+        m_Tick = 0;
+        m_Time = 0.0f;
+        m_Cursor = 0;
+        m_LastDelta = 0.0f;
+        m_Exhausted = false;
+    }
+
+    virtual ~Replay()
+    {
+        if (m_File)
+        {
+            fclose(m_File);
+            LOG("Replay : %lu ticks recorded\n", m_Tick);
+        }
+    }
+
+    void write(Record type, const void* data, size_t size)
+    {
+        uint8_t header[2] = { static_cast<uint8_t>(type), static_cast<uint8_t>(size) };
+        fwrite(header, type == TICK ? 1 : 2, 1, m_File);
+        fwrite(data, size, 1, m_File);
+    }
+
+    bool load(const std::string& path)
+    {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == NULL)
+        {
+            LOG("Replay : Failed to open %s!\n", path.c_str());
+            return false;
+        }
+
+        uint32_t header[3];
+        if (fread(header, sizeof(header), 1, file) != 1 || header[0] != Magic || header[1] != Version)
+        {
+            LOG("Replay : %s is not a replay log!\n", path.c_str());
+            fclose(file);
+            return false;
+        }
+        m_Seed = header[2];
+
+        unsigned char buffer[4096];
+        size_t count;
+        while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            m_Log.insert(m_Log.end(), buffer, buffer + count);
+        fclose(file);
+
+        // NOTE : Count ticks and make sure no record runs past the end of the log.
+        unsigned long ticks = 0;
+        size_t cursor = 0;
+        while (cursor < m_Log.size())
+        {
+            size_t size = m_Log[cursor] == TICK ? 1 + sizeof(float) : (cursor + 1 < m_Log.size() ? 2 + m_Log[cursor + 1] : m_Log.size());
+            if (cursor + size > m_Log.size())
+                break;
+            if (m_Log[cursor] == TICK)
+                ticks++;
+            cursor += size;
+        }
+        m_Log.resize(cursor);
+        m_Ticks = ticks;
+        return true;
+    }
+
+    Mode m_Mode;
+    uint32_t m_Seed;
+
+    FILE* m_File;
+
+    std::vector<unsigned char> m_Log;
+    size_t m_Cursor;
+    unsigned long m_Ticks;
+    float m_LastDelta;
+    bool m_Exhausted;
+
+    unsigned long m_Tick;
+    float m_Time;
+};
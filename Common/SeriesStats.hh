@@ -0,0 +1,241 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+#include <vector>
+
+#include "Parallel.hh"
+
+// Sliding time window statistics over many time-stamped series at once.
+//
+// Every series owns a power of two ring of samples, and the rings are packed side by side in
+// two flat columns, one for timestamps and one for values, so a series' window is one or two
+// contiguous runs of floats :
+//
+//     SeriesStats stats(10000, 512, 5.0);         // series, samples per series, window in seconds
+//     stats.push(series, time, value);            // timestamps increase within a series
+//     stats.update(now);                          // once per tick
+//     stats.average(series), stats.percentile(series, SeriesStats::P99), ...
+//
+// update() drops the samples older than 'now - window' from every series, then computes the
+// count, average, minimum and maximum of what is left in a single pass, and approximate
+// percentiles from a histogram of the window, all in parallel over series. The histogram has
+// BINS bins between the window's minimum and maximum, percentiles are off by at most one bin.
+//
+// A window holding more samples than a ring only covers the most recent ones.
+
+class SeriesStats
+{
+public:
+    enum Percentile
+    {
+        P50,
+        P90,
+        P99,
+        PERCENTILE_COUNT
+    };
+
+    static const unsigned int BINS = 32;
+
+    SeriesStats(size_t series, size_t capacity, double window)
+    {
+        m_Capacity = 1;
+        while (m_Capacity < capacity)
+            m_Capacity <<= 1;
+        m_Window = window;
+
+        m_Times.resize(series * m_Capacity);
+        m_Values.resize(series * m_Capacity);
+        m_Write.assign(series, 0);
+        m_Tail.assign(series, 0);
+
+        m_Count.assign(series, 0);
+        m_Average.assign(series, 0.0f);
+        m_Minimum.assign(series, 0.0f);
+        m_Maximum.assign(series, 0.0f);
+        m_Percentiles.assign(series * PERCENTILE_COUNT, 0.0f);
+    }
+
+    virtual ~SeriesStats()
+    {
+    }
+
+    inline void push(size_t series, double time, float value)
+    {
+        uint64_t sequence = m_Write[series]++;
+        size_t index = series * m_Capacity + (sequence & (m_Capacity - 1));
+        m_Times[index] = time;
+        m_Values[index] = value;
+    }
+
+    void update(double now)
+    {
+        Parallel::forEach(size(), [&](size_t begin, size_t end)
+        {
+            for (size_t series = begin; series < end; series++)
+                update(series, now);
+        }, 64);
+    }
+
+    inline size_t size() const { return m_Write.size(); }
+    inline size_t capacity() const { return m_Capacity; }
+    inline double window() const { return m_Window; }
+
+    // Bytes held by the sample columns.
+    inline size_t memory() const { return m_Times.size() * sizeof(double) + m_Values.size() * sizeof(float); }
+
+    inline unsigned int count(size_t series) const { return m_Count[series]; }
+    inline float average(size_t series) const { return m_Average[series]; }
+    inline float minimum(size_t series) const { return m_Minimum[series]; }
+    inline float maximum(size_t series) const { return m_Maximum[series]; }
+    inline float percentile(size_t series, Percentile p) const { return m_Percentiles[series * PERCENTILE_COUNT + p]; }
+
+private:
+    // NOTE : Independent accumulators per lane so the reductions vectorize without -ffast-math.
+    static const unsigned int LANES = 8;
+
+    struct Accumulator
+    {
+        float Sum[LANES];
+        float Minimum[LANES];
+        float Maximum[LANES];
+    };
+
+    static void accumulate(Accumulator& accumulator, const float* values, size_t count)
+    {
+        // NOTE : Work on local copies, the compiler can't keep them in registers through a reference that may alias values.
+        float sum[LANES];
+        float minimum[LANES];
+        float maximum[LANES];
+        std::copy(accumulator.Sum, accumulator.Sum + LANES, sum);
+        std::copy(accumulator.Minimum, accumulator.Minimum + LANES, minimum);
+        std::copy(accumulator.Maximum, accumulator.Maximum + LANES, maximum);
+
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES)
+        {
+            for (unsigned int l = 0; l < LANES; l++)
+            {
+                float v = values[i + l];
+                sum[l] += v;
+                minimum[l] = v < minimum[l] ? v : minimum[l];
+                maximum[l] = v > maximum[l] ? v : maximum[l];
+            }
+        }
+        for (unsigned int l = 0; i < count; i++, l++)
+        {
+            float v = values[i];
+            sum[l] += v;
+            minimum[l] = std::min(minimum[l], v);
+            maximum[l] = std::max(maximum[l], v);
+        }
+
+        std::copy(sum, sum + LANES, accumulator.Sum);
+        std::copy(minimum, minimum + LANES, accumulator.Minimum);
+        std::copy(maximum, maximum + LANES, accumulator.Maximum);
+    }
+
+    static void histogram(unsigned int* bins, const float* values, size_t count, float minimum, float scale)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            unsigned int bin = static_cast<unsigned int>((values[i] - minimum) * scale);
+            bins[std::min(bin, BINS - 1)]++;
+        }
+    }
+
+    void update(size_t series, double now)
+    {
+        const size_t mask = m_Capacity - 1;
+        const double* times = &m_Times[series * m_Capacity];
+        const float* values = &m_Values[series * m_Capacity];
+
+        // NOTE : Timestamps only grow, so the window's tail moves forward a few samples per tick.
+        uint64_t head = m_Write[series];
+        uint64_t tail = std::max(m_Tail[series], head - std::min<uint64_t>(head, m_Capacity));
+        double start = now - m_Window;
+        while (tail < head && times[tail & mask] < start)
+            tail++;
+        m_Tail[series] = tail;
+
+        size_t count = static_cast<size_t>(head - tail);
+        m_Count[series] = static_cast<unsigned int>(count);
+
+        float* percentiles = &m_Percentiles[series * PERCENTILE_COUNT];
+        if (count == 0)
+        {
+            m_Average[series] = m_Minimum[series] = m_Maximum[series] = 0.0f;
+            std::fill(percentiles, percentiles + PERCENTILE_COUNT, 0.0f);
+            return;
+        }
+
+        // The window is at most two contiguous runs : up to the end of the ring, then from its start.
+        size_t first = tail & mask;
+        size_t firstCount = std::min(count, m_Capacity - first);
+        size_t secondCount = count - firstCount;
+
+        Accumulator accumulator;
+        std::fill(accumulator.Sum, accumulator.Sum + LANES, 0.0f);
+        std::fill(accumulator.Minimum, accumulator.Minimum + LANES, std::numeric_limits<float>::max());
+        std::fill(accumulator.Maximum, accumulator.Maximum + LANES, -std::numeric_limits<float>::max());
+        accumulate(accumulator, values + first, firstCount);
+        accumulate(accumulator, values, secondCount);
+
+        float sum = 0.0f;
+        float minimum = std::numeric_limits<float>::max();
+        float maximum = -std::numeric_limits<float>::max();
+        for (unsigned int l = 0; l < LANES; l++)
+        {
+            sum += accumulator.Sum[l];
+            minimum = std::min(minimum, accumulator.Minimum[l]);
+            maximum = std::max(maximum, accumulator.Maximum[l]);
+        }
+
+        m_Average[series] = sum / count;
+        m_Minimum[series] = minimum;
+        m_Maximum[series] = maximum;
+
+        if (maximum <= minimum)
+        {
+            std::fill(percentiles, percentiles + PERCENTILE_COUNT, minimum);
+            return;
+        }
+
+        unsigned int bins[BINS] = {};
+        float scale = BINS / (maximum - minimum);
+        histogram(bins, values + first, firstCount, minimum, scale);
+        histogram(bins, values, secondCount, minimum, scale);
+
+        static const float ranks[PERCENTILE_COUNT] = { 0.50f, 0.90f, 0.99f };
+        float width = (maximum - minimum) / BINS;
+        unsigned int bin = 0;
+        unsigned int below = 0;
+        for (unsigned int p = 0; p < PERCENTILE_COUNT; p++)
+        {
+            float rank = ranks[p] * (count - 1);
+            while (bin < BINS - 1 && below + bins[bin] <= rank)
+                below += bins[bin++];
+
+            // NOTE : Interpolate linearly inside the bin the rank falls into.
+            float fraction = bins[bin] > 0 ? (rank - below + 0.5f) / bins[bin] : 0.5f;
+            percentiles[p] = minimum + (bin + std::min(fraction, 1.0f)) * width;
+        }
+    }
+
+    size_t m_Capacity;
+    double m_Window;
+
+    std::vector<double> m_Times;
+    std::vector<float> m_Values;
+    std::vector<uint64_t> m_Write;
+    std::vector<uint64_t> m_Tail;
+
+    std::vector<unsigned int> m_Count;
+    std::vector<float> m_Average;
+    std::vector<float> m_Minimum;
+    std::vector<float> m_Maximum;
+    std::vector<float> m_Percentiles;
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Shared memory sample feed between processes on the same host.
+//
+// A POSIX shm segment holds a header followed by a power of two ring of samples. A single
+// producer writes the slot for sequence N, then publishes N + 1 as the write counter; the
+// reader polls the counter and copies new samples straight out of the mapping, so the fast
+// path has no intermediate buffers, no formatting and no syscalls :
+//
+//     SharedRing ring;
+//     ring.create("/raindance-stream", 4096);          // producer
+//     ring.push(time, value);
+//
+//     SharedRing ring;
+//     ring.open("/raindance-stream");                  // reader
+//     ring.poll([&](const SharedRing::Sample& sample) { ... });
+//
+// The producer never waits. A reader that falls more than a ring behind skips what it lost
+// and counts it as overrun. The reader publishes how far it got in the header, so the
+// producer can report its lag. There is a single such slot : one reader per segment.
+
+class SharedRing
+{
+public:
+    struct Sample
+    {
+        double Time;
+        double Value;
+    };
+
+    struct Header
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Capacity;
+        alignas(64) std::atomic<uint64_t> Write;
+        alignas(64) std::atomic<uint64_t> Read;
+    };
+
+#if __cplusplus >= 201703L
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The counters are shared between processes");
+#else
+    static_assert((sizeof(long) == 8 ? ATOMIC_LONG_LOCK_FREE : ATOMIC_LLONG_LOCK_FREE) == 2, "The counters are shared between processes");
+#endif
+
+    static const uint32_t Magic = 0x52444652; // 'RDFR'
+    static const uint32_t Version = 1;
+
+    SharedRing()
+    {
+        m_Header = NULL;
+        m_Samples = NULL;
+        m_Size = 0;
+        m_Owner = false;
+        m_Cursor = 0;
+        m_Overrun = 0;
+    }
+
+    virtual ~SharedRing()
+    {
+        close();
+    }
+
+    // Creates (or recreates) the segment. 'capacity' is rounded up to a power of two.
+    bool create(const std::string& name, uint64_t capacity)
+    {
+        close();
+
+        uint64_t count = 1;
+        while (count < capacity)
+            count <<= 1;
+
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+            return false;
+
+        size_t size = sizeof(Header) + count * sizeof(Sample);
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0 || !map(fd, size))
+        {
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        ::close(fd);
+
+        m_Header->Capacity = count;
+        m_Header->Write.store(0, std::memory_order_relaxed);
+        m_Header->Read.store(0, std::memory_order_relaxed);
+        m_Header->Version = Version;
+        std::atomic_thread_fence(std::memory_order_release);
+        m_Header->Magic = Magic;
+
+        m_Name = name;
+        m_Owner = true;
+        return true;
+    }
+
+    // Maps an existing segment and starts reading from its current write position.
+    bool open(const std::string& name)
+    {
+        close();
+
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(Header) || !map(fd, status.st_size))
+        {
+            ::close(fd);
+            return false;
+        }
+        ::close(fd);
+
+        if (m_Header->Magic != Magic || m_Header->Version != Version ||
+            sizeof(Header) + m_Header->Capacity * sizeof(Sample) > m_Size)
+        {
+            close();
+            return false;
+        }
+
+        m_Name = name;
+        m_Cursor = m_Header->Write.load(std::memory_order_acquire);
+        return true;
+    }
+
+    void close()
+    {
+        if (m_Header != NULL)
+            munmap(m_Header, m_Size);
+        if (m_Owner)
+            shm_unlink(m_Name.c_str());
+
+        m_Header = NULL;
+        m_Samples = NULL;
+        m_Size = 0;
+        m_Owner = false;
+    }
+
+    inline bool valid() const { return m_Header != NULL; }
+
+    // Producer side.
+    inline void push(double time, double value)
+    {
+        uint64_t sequence = m_Header->Write.load(std::memory_order_relaxed);
+
+        // NOTE : Publishing 'sequence' must be visible before the slot starts changing, the reader
+        // relies on it to detect a sample being overwritten while it copied it.
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Sample& sample = m_Samples[sequence & (m_Header->Capacity - 1)];
+        sample.Time = time;
+        sample.Value = value;
+        m_Header->Write.store(sequence + 1, std::memory_order_release);
+    }
+
+    // Reader side. Calls function(sample) for every sample published since the last poll, in
+    // order, with a copy taken from the mapping. Returns how many were delivered.
+    template <typename Function>
+    size_t poll(Function function)
+    {
+        uint64_t capacity = m_Header->Capacity;
+        uint64_t write = m_Header->Write.load(std::memory_order_acquire);
+
+        if (write - m_Cursor > capacity)
+        {
+            m_Overrun += write - m_Cursor - capacity;
+            m_Cursor = write - capacity;
+        }
+
+        size_t delivered = 0;
+        for (; m_Cursor < write; m_Cursor++)
+        {
+            Sample sample = m_Samples[m_Cursor & (capacity - 1)];
+
+            // NOTE : The producer may have lapped us while we were copying, check once the copy
+            // is done and drop it if the slot was being reused.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_Header->Write.load(std::memory_order_relaxed) >= m_Cursor + capacity)
+            {
+                m_Overrun++;
+                continue;
+            }
+
+            function(sample);
+            delivered++;
+        }
+
+        m_Header->Read.store(m_Cursor, std::memory_order_release);
+        return delivered;
+    }
+
+    inline uint64_t written() const { return m_Header->Write.load(std::memory_order_acquire); }
+    inline uint64_t read() const { return m_Header->Read.load(std::memory_order_acquire); }
+    inline uint64_t lag() const { return written() - read(); }
+    inline uint64_t capacity() const { return m_Header->Capacity; }
+    inline uint64_t overrun() const { return m_Overrun; }
+
+private:
+    bool map(int fd, size_t size)
+    {
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED)
+            return false;
+
+        m_Header = static_cast<Header*>(memory);
+        m_Samples = reinterpret_cast<Sample*>(static_cast<char*>(memory) + sizeof(Header));
+        m_Size = size;
+        return true;
+    }
+
+    std::string m_Name;
+    Header* m_Header;
+    Sample* m_Samples;
+    size_t m_Size;
+    bool m_Owner;
+
+    uint64_t m_Cursor;
+    uint64_t m_Overrun;
+};
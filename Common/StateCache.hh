@@ -0,0 +1,352 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <atomic>
+#include <mutex>
+#include <dlfcn.h>
+
+#include "CurrentContext.hh"
+
+// Shadowed GL state.
+//
+// Keeps the last value set for blend / depth / cull / scissor enables, the blend and depth
+// functions, the depth mask, the viewport, and the current program, array / element buffers
+// and vertex array, and drops calls that would set them to the value they already have.
+//
+// Like the draw call counters in Benchmark.hh, the GL 1.x entry points are interposed and the
+// GLEW function pointers wrapped, so redundant calls made inside the engine's primitives are
+// caught as well as the samples' own. GL state belongs to a context, so each thread keeps one
+// shadow per context it has made current, several windows sharing the main loop included.
+//
+// Elision is opt-in : pass --state-cache. Every call is then counted, as well as the redundant
+// ones it dropped. The headless benchmark reports both per frame, and the ratio is logged on
+// exit. Without the flag nothing is wrapped and calls go straight to the driver.
+
+namespace StateCache
+{
+    struct Counters
+    {
+        Counters()
+        {
+            Calls = 0;
+            Redundant = 0;
+        }
+
+        ~Counters()
+        {
+            if (Calls > 0)
+                LOG("StateCache : %lu state calls, %lu redundant ones elided (%.1f%%)\n",
+                    Calls.load(), Redundant.load(), 100.0 * Redundant.load() / Calls.load());
+        }
+
+        std::atomic<unsigned long> Calls;
+        std::atomic<unsigned long> Redundant;
+    };
+
+    inline Counters& counters()
+    {
+        static Counters counters;
+        return counters;
+    }
+
+    inline bool& enabled()
+    {
+        static bool enabled = false;
+        return enabled;
+    }
+
+    // NOTE : -1 means unknown, the next call always goes through.
+    struct Shadow
+    {
+        Shadow()
+        {
+            invalidate();
+        }
+
+        void invalidate()
+        {
+            Blend = DepthTest = CullFace = ScissorTest = -1;
+            BlendSource = BlendDestination = -1;
+            DepthFunc = DepthMask = -1;
+            Viewport[0] = Viewport[1] = Viewport[2] = Viewport[3] = -1;
+            Program = ArrayBuffer = ElementArrayBuffer = VertexArray = -1;
+        }
+
+        long long Blend;
+        long long DepthTest;
+        long long CullFace;
+        long long ScissorTest;
+        long long BlendSource;
+        long long BlendDestination;
+        long long DepthFunc;
+        long long DepthMask;
+        long long Viewport[4];
+        long long Program;
+        long long ArrayBuffer;
+        long long ElementArrayBuffer;
+        long long VertexArray;
+    };
+
+    inline Shadow& shadow()
+    {
+        return contextLocal<Shadow>();
+    }
+
+    inline long long* capability(GLenum cap)
+    {
+        switch (cap)
+        {
+        case GL_BLEND: return &shadow().Blend;
+        case GL_DEPTH_TEST: return &shadow().DepthTest;
+        case GL_CULL_FACE: return &shadow().CullFace;
+        case GL_SCISSOR_TEST: return &shadow().ScissorTest;
+        default: return NULL;
+        }
+    }
+
+    inline long long* buffer(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: return &shadow().ArrayBuffer;
+        case GL_ELEMENT_ARRAY_BUFFER: return &shadow().ElementArrayBuffer;
+        default: return NULL;
+        }
+    }
+
+    // Counts a state call and returns whether it has to reach the driver.
+    inline bool issue(bool redundant)
+    {
+        counters().Calls++;
+        if (!redundant)
+            return true;
+
+        counters().Redundant++;
+        return false;
+    }
+
+    inline bool update(long long& shadowed, long long value)
+    {
+        if (!issue(shadowed == value))
+            return false;
+        shadowed = value;
+        return true;
+    }
+
+    struct Next
+    {
+        PFNGLUSEPROGRAMPROC UseProgram;
+        PFNGLDELETEPROGRAMPROC DeleteProgram;
+        PFNGLBINDBUFFERPROC BindBuffer;
+        PFNGLDELETEBUFFERSPROC DeleteBuffers;
+        PFNGLBINDVERTEXARRAYPROC BindVertexArray;
+        PFNGLDELETEVERTEXARRAYSPROC DeleteVertexArrays;
+        PFNGLBLENDFUNCSEPARATEPROC BlendFuncSeparate;
+    };
+
+    inline Next& next()
+    {
+        static Next next = {};
+        return next;
+    }
+
+    inline void GLAPIENTRY useProgram(GLuint program)
+    {
+        if (update(shadow().Program, program))
+            next().UseProgram(program);
+    }
+
+    inline void GLAPIENTRY deleteProgram(GLuint program)
+    {
+        if (shadow().Program == program)
+            shadow().Program = -1;
+        next().DeleteProgram(program);
+    }
+
+    inline void GLAPIENTRY bindBuffer(GLenum target, GLuint name)
+    {
+        long long* shadowed = buffer(target);
+        if (shadowed == NULL || update(*shadowed, name))
+            next().BindBuffer(target, name);
+    }
+
+    inline void GLAPIENTRY deleteBuffers(GLsizei count, const GLuint* names)
+    {
+        // NOTE : Deleting a bound buffer unbinds it.
+        for (GLsizei i = 0; i < count; i++)
+        {
+            if (shadow().ArrayBuffer == names[i])
+                shadow().ArrayBuffer = 0;
+            if (shadow().ElementArrayBuffer == names[i])
+                shadow().ElementArrayBuffer = 0;
+        }
+        next().DeleteBuffers(count, names);
+    }
+
+    inline void GLAPIENTRY bindVertexArray(GLuint name)
+    {
+        if (update(shadow().VertexArray, name))
+        {
+            // NOTE : The element array binding is vertex array state.
+            shadow().ElementArrayBuffer = -1;
+            next().BindVertexArray(name);
+        }
+    }
+
+    inline void GLAPIENTRY deleteVertexArrays(GLsizei count, const GLuint* names)
+    {
+        for (GLsizei i = 0; i < count; i++)
+            if (shadow().VertexArray == names[i])
+            {
+                shadow().VertexArray = 0;
+                shadow().ElementArrayBuffer = -1;
+            }
+        next().DeleteVertexArrays(count, names);
+    }
+
+    inline void GLAPIENTRY blendFuncSeparate(GLenum sourceRGB, GLenum destinationRGB, GLenum sourceAlpha, GLenum destinationAlpha)
+    {
+        shadow().BlendSource = shadow().BlendDestination = -1;
+        next().BlendFuncSeparate(sourceRGB, destinationRGB, sourceAlpha, destinationAlpha);
+    }
+
+    // Wraps the GLEW entry points, once they are loaded.
+    inline void install()
+    {
+        static std::atomic<bool> installed(false);
+        if (installed || !enabled() || __glewUseProgram == NULL)
+            return;
+
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (installed)
+            return;
+
+        next().UseProgram = __glewUseProgram;
+        next().DeleteProgram = __glewDeleteProgram;
+        next().BindBuffer = __glewBindBuffer;
+        next().DeleteBuffers = __glewDeleteBuffers;
+        next().BindVertexArray = __glewBindVertexArray;
+        next().DeleteVertexArrays = __glewDeleteVertexArrays;
+        next().BlendFuncSeparate = __glewBlendFuncSeparate;
+
+        __glewUseProgram = useProgram;
+        __glewDeleteProgram = deleteProgram;
+        __glewBindBuffer = bindBuffer;
+        __glewDeleteBuffers = deleteBuffers;
+        __glewBindVertexArray = bindVertexArray;
+        __glewDeleteVertexArrays = deleteVertexArrays;
+        __glewBlendFuncSeparate = blendFuncSeparate;
+
+        installed = true;
+    }
+}
+
+#ifdef RD_BENCHMARK_IMPLEMENTATION
+
+#define RD_FORWARD_GL(name, type) static type next = (type) dlsym(RTLD_NEXT, #name)
+
+extern "C" void GLAPIENTRY glEnable(GLenum cap)
+{
+    typedef void (GLAPIENTRY *Function)(GLenum);
+    RD_FORWARD_GL(glEnable, Function);
+    if (!StateCache::enabled())
+    {
+        next(cap);
+        return;
+    }
+    StateCache::install();
+    long long* shadowed = StateCache::capability(cap);
+    if (shadowed == NULL || StateCache::update(*shadowed, 1))
+        next(cap);
+}
+
+extern "C" void GLAPIENTRY glDisable(GLenum cap)
+{
+    typedef void (GLAPIENTRY *Function)(GLenum);
+    RD_FORWARD_GL(glDisable, Function);
+    if (!StateCache::enabled())
+    {
+        next(cap);
+        return;
+    }
+    StateCache::install();
+    long long* shadowed = StateCache::capability(cap);
+    if (shadowed == NULL || StateCache::update(*shadowed, 0))
+        next(cap);
+}
+
+extern "C" void GLAPIENTRY glBlendFunc(GLenum source, GLenum destination)
+{
+    typedef void (GLAPIENTRY *Function)(GLenum, GLenum);
+    RD_FORWARD_GL(glBlendFunc, Function);
+    if (!StateCache::enabled())
+    {
+        next(source, destination);
+        return;
+    }
+    StateCache::install();
+
+    StateCache::Shadow& shadow = StateCache::shadow();
+    if (StateCache::issue(shadow.BlendSource == source && shadow.BlendDestination == destination))
+    {
+        shadow.BlendSource = source;
+        shadow.BlendDestination = destination;
+        next(source, destination);
+    }
+}
+
+extern "C" void GLAPIENTRY glDepthFunc(GLenum function)
+{
+    typedef void (GLAPIENTRY *Function)(GLenum);
+    RD_FORWARD_GL(glDepthFunc, Function);
+    if (!StateCache::enabled())
+    {
+        next(function);
+        return;
+    }
+    StateCache::install();
+    if (StateCache::update(StateCache::shadow().DepthFunc, function))
+        next(function);
+}
+
+extern "C" void GLAPIENTRY glDepthMask(GLboolean flag)
+{
+    typedef void (GLAPIENTRY *Function)(GLboolean);
+    RD_FORWARD_GL(glDepthMask, Function);
+    if (!StateCache::enabled())
+    {
+        next(flag);
+        return;
+    }
+    StateCache::install();
+    if (StateCache::update(StateCache::shadow().DepthMask, flag))
+        next(flag);
+}
+
+extern "C" void GLAPIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    typedef void (GLAPIENTRY *Function)(GLint, GLint, GLsizei, GLsizei);
+    RD_FORWARD_GL(glViewport, Function);
+    if (!StateCache::enabled())
+    {
+        next(x, y, width, height);
+        return;
+    }
+    StateCache::install();
+
+    long long* viewport = StateCache::shadow().Viewport;
+    if (StateCache::issue(viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height))
+    {
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+        next(x, y, width, height);
+    }
+}
+
+#undef RD_FORWARD_GL
+
+#endif
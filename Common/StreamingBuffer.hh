@@ -0,0 +1,214 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <chrono>
+
+// Ring of N frame regions in one buffer object, each guarded by a fence.
+// The CPU writes region (frame % N) while the GPU is still reading the previous ones,
+// and only waits when it catches up with a region the GPU has not released yet.
+//
+// When ARB_buffer_storage is available the whole ring is mapped once, persistently.
+// Otherwise, or if that mapping fails, each region is mapped unsynchronized on demand,
+// behind the same fences. map() returns NULL when a region can't be mapped : callers then
+// skip that frame's upload and the draws sourcing it, and neither unmap() nor fence().
+//
+// Usage, once per frame:
+//
+//     auto data = stream.map();
+//     ... write up to stream.frameSize() bytes ...
+//     stream.unmap();
+//     ... draw sourcing stream.id() at stream.offset() ...
+//     stream.fence();
+
+class StreamingBuffer
+{
+public:
+    StreamingBuffer(GLenum target, size_t frameSize, unsigned int frames = 3)
+    {
+        m_Target = target;
+        m_FrameSize = (frameSize + 255) / 256 * 256;
+        m_Frames = frames;
+        m_Frame = 0;
+        m_Fences.assign(frames, (GLsync) 0);
+        m_Memory = NULL;
+        m_Mapped = NULL;
+
+        m_Persistent = GLEW_ARB_buffer_storage;
+
+        m_Stall = 0.0;
+        m_MaxStall = 0.0;
+        m_TotalStall = 0.0;
+        m_FrameCount = 0;
+        m_Failures = 0;
+
+        glGenBuffers(1, &m_Buffer);
+        glBindBuffer(m_Target, m_Buffer);
+
+        if (m_Persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(m_Target, m_FrameSize * m_Frames, NULL, flags);
+            m_Memory = static_cast<unsigned char*>(glMapBufferRange(m_Target, 0, m_FrameSize * m_Frames, flags));
+
+            if (m_Memory == NULL)
+            {
+                // NOTE : Storage is immutable, the fallback needs a fresh buffer object.
+                LOG("StreamingBuffer : Persistent mapping failed, falling back to unsynchronized maps\n");
+                m_Persistent = false;
+                glBindBuffer(m_Target, 0);
+                glDeleteBuffers(1, &m_Buffer);
+                glGenBuffers(1, &m_Buffer);
+                glBindBuffer(m_Target, m_Buffer);
+            }
+        }
+
+        if (!m_Persistent)
+            glBufferData(m_Target, m_FrameSize * m_Frames, NULL, GL_STREAM_DRAW);
+
+        glBindBuffer(m_Target, 0);
+    }
+
+    virtual ~StreamingBuffer()
+    {
+        for (auto fence : m_Fences)
+            if (fence)
+                glDeleteSync(fence);
+
+        if (m_Persistent)
+        {
+            glBindBuffer(m_Target, m_Buffer);
+            glUnmapBuffer(m_Target);
+            glBindBuffer(m_Target, 0);
+        }
+
+        glDeleteBuffers(1, &m_Buffer);
+    }
+
+    void* map()
+    {
+        wait();
+
+        if (m_Persistent)
+            m_Mapped = m_Memory + offset();
+        else
+        {
+            glBindBuffer(m_Target, m_Buffer);
+            m_Mapped = glMapBufferRange(m_Target, offset(), m_FrameSize, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            glBindBuffer(m_Target, 0);
+        }
+
+        if (m_Mapped == NULL)
+        {
+            if (m_Failures == 0)
+                LOG("StreamingBuffer : Failed to map %lu bytes at offset %lu, skipping the frame\n",
+                    static_cast<unsigned long>(m_FrameSize), static_cast<unsigned long>(offset()));
+            m_Failures++;
+        }
+
+        return m_Mapped;
+    }
+
+    void unmap()
+    {
+        if (m_Mapped == NULL)
+            return;
+
+        if (!m_Persistent)
+        {
+            glBindBuffer(m_Target, m_Buffer);
+            glUnmapBuffer(m_Target);
+            glBindBuffer(m_Target, 0);
+        }
+
+        m_Mapped = NULL;
+    }
+
+    // Call after the last draw reading the current region has been issued.
+    void fence()
+    {
+        GLsync& fence = m_Fences[m_Frame % m_Frames];
+        if (fence)
+            glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        m_Frame++;
+    }
+
+    inline GLuint id() const { return m_Buffer; }
+    inline size_t offset() const { return (m_Frame % m_Frames) * m_FrameSize; }
+    inline size_t frameSize() const { return m_FrameSize; }
+    inline bool persistent() const { return m_Persistent; }
+
+    // Time spent waiting on the GPU in the last map(), in milliseconds.
+    inline double stall() const { return m_Stall; }
+    inline double maxStall() const { return m_MaxStall; }
+    inline double averageStall() const { return m_FrameCount == 0 ? 0.0 : m_TotalStall / m_FrameCount; }
+
+    // Longest stall of any streaming buffer mapped on this thread since the previous call, in
+    // milliseconds. Benchmark reads it once per frame.
+    static double frameStall()
+    {
+        double stall = worstStall();
+        worstStall() = 0.0;
+        return stall;
+    }
+
+    void dump(const char* name)
+    {
+        LOG("%s : %s, %u x %lu bytes, %lu frames, stall avg %.3f ms, max %.3f ms, %lu failed maps\n",
+            name, m_Persistent ? "persistent" : "unsynchronized",
+            m_Frames, static_cast<unsigned long>(m_FrameSize), m_FrameCount,
+            averageStall(), m_MaxStall, m_Failures);
+    }
+
+private:
+    static double& worstStall()
+    {
+        static thread_local double stall = 0.0;
+        return stall;
+    }
+
+    void wait()
+    {
+        m_Stall = 0.0;
+
+        GLsync& fence = m_Fences[m_Frame % m_Frames];
+        if (fence)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+
+            GLenum status;
+            do
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            while (status == GL_TIMEOUT_EXPIRED);
+
+            glDeleteSync(fence);
+            fence = (GLsync) 0;
+
+            m_Stall = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        m_MaxStall = std::max(m_MaxStall, m_Stall);
+        worstStall() = std::max(worstStall(), m_Stall);
+        m_TotalStall += m_Stall;
+        m_FrameCount++;
+    }
+
+    GLenum m_Target;
+    GLuint m_Buffer;
+    size_t m_FrameSize;
+    unsigned int m_Frames;
+    unsigned long m_Frame;
+    std::vector<GLsync> m_Fences;
+
+    bool m_Persistent;
+    unsigned char* m_Memory;
+    void* m_Mapped;
+
+    double m_Stall;
+    double m_MaxStall;
+    double m_TotalStall;
+    unsigned long m_FrameCount;
+    unsigned long m_Failures;
+};
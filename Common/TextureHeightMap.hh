@@ -0,0 +1,252 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <algorithm>
+
+#include "Uniforms.hh"
+
+// Height map drawn from a single channel float texture.
+//
+// Same interface as the engine's HeightMap, but only the values live on the GPU : one R32F
+// texel per cell instead of a position, normal and color per vertex. The grid itself has no
+// vertex data at all, each row is an instance of a triangle strip whose vertices are placed
+// from gl_VertexID / gl_InstanceID, and the vertex shader displaces them and derives normals
+// from the neighbouring texels.
+//
+// setValue() only touches the host copy and grows a dirty rectangle, update() uploads each
+// one with a glTexSubImage2D(). A value on a row not adjacent to the current rectangle starts
+// a new one, so a band of rows wrapping from the bottom to the top of the map is sent as two
+// bands rather than the whole texture. Past MaxDirty rectangles the last one grows instead.
+//
+// The color range is the minimum and maximum of the current values, kept per row so update()
+// only rescans the rows it uploads.
+
+class TextureHeightMap
+{
+public:
+    TextureHeightMap(unsigned int width, unsigned int height)
+    {
+        m_Width = width;
+        m_Height = height;
+        m_Values.assign(static_cast<size_t>(width) * height, 0.0f);
+        m_RowMinimum.assign(height, 0.0f);
+        m_RowMaximum.assign(height, 0.0f);
+        m_Minimum = 0.0f;
+        m_Maximum = 0.0f;
+        m_Uploaded = 0;
+        m_DirtyCount = 0;
+
+        glGenTextures(1, &m_Texture);
+        glBindTexture(GL_TEXTURE_2D, m_Texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, m_Values.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // NOTE : Core profiles refuse draws without a vertex array, even one with no attributes.
+        glGenVertexArrays(1, &m_VAO);
+
+        m_Shader = ResourceManager::getInstance().loadShader("Common/TextureHeightMap", vertexShader(), fragmentShader());
+        m_Shader->use();
+        GLuint program = Uniforms::current();
+        m_ModelViewMatrix = Uniforms::Location(program, "u_ModelViewMatrix");
+        m_ProjectionMatrix = Uniforms::Location(program, "u_ProjectionMatrix");
+        m_NormalMatrix = Uniforms::Location(program, "u_NormalMatrix");
+        m_Range = Uniforms::Location(program, "u_Range");
+        m_Sampler = Uniforms::Location(program, "u_Values");
+    }
+
+    virtual ~TextureHeightMap()
+    {
+        glDeleteVertexArrays(1, &m_VAO);
+        glDeleteTextures(1, &m_Texture);
+        ResourceManager::getInstance().unload(m_Shader);
+    }
+
+    static const unsigned int MaxDirty = 4;
+
+    inline void setValue(unsigned int i, unsigned int j, float value)
+    {
+        m_Values[static_cast<size_t>(j) * m_Width + i] = value;
+
+        if (m_DirtyCount == 0 || (m_DirtyCount < MaxDirty && (j + 1 < m_Dirty[m_DirtyCount - 1].Y0 || j > m_Dirty[m_DirtyCount - 1].Y1)))
+        {
+            Rectangle rectangle = { i, j, i + 1, j + 1 };
+            m_Dirty[m_DirtyCount++] = rectangle;
+            return;
+        }
+
+        Rectangle& dirty = m_Dirty[m_DirtyCount - 1];
+        dirty.X0 = std::min(dirty.X0, i);
+        dirty.Y0 = std::min(dirty.Y0, j);
+        dirty.X1 = std::max(dirty.X1, i + 1);
+        dirty.Y1 = std::max(dirty.Y1, j + 1);
+    }
+
+    inline float getValue(unsigned int i, unsigned int j) const { return m_Values[static_cast<size_t>(j) * m_Width + i]; }
+
+    // Uploads the values changed since the last update.
+    void update()
+    {
+        m_Uploaded = 0;
+        if (m_DirtyCount == 0)
+            return;
+
+        glBindTexture(GL_TEXTURE_2D, m_Texture);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, m_Width);
+
+        for (unsigned int r = 0; r < m_DirtyCount; r++)
+        {
+            const Rectangle& dirty = m_Dirty[r];
+            unsigned int width = dirty.X1 - dirty.X0;
+            unsigned int height = dirty.Y1 - dirty.Y0;
+
+            // NOTE : Whole rows, a value left outside the rectangle may have been the row's extreme.
+            for (unsigned int j = dirty.Y0; j < dirty.Y1; j++)
+            {
+                const float* row = &m_Values[static_cast<size_t>(j) * m_Width];
+                auto range = std::minmax_element(row, row + m_Width);
+                m_RowMinimum[j] = *range.first;
+                m_RowMaximum[j] = *range.second;
+            }
+
+            glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.X0, dirty.Y0, width, height, GL_RED, GL_FLOAT,
+                            &m_Values[static_cast<size_t>(dirty.Y0) * m_Width + dirty.X0]);
+            m_Uploaded += static_cast<size_t>(width) * height * sizeof(float);
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        m_Minimum = *std::min_element(m_RowMinimum.begin(), m_RowMinimum.end());
+        m_Maximum = *std::max_element(m_RowMaximum.begin(), m_RowMaximum.end());
+        m_DirtyCount = 0;
+    }
+
+    void draw(Context& context, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection)
+    {
+        (void) context;
+
+        if (m_Width < 2 || m_Height < 2)
+            return;
+
+        glm::mat4 modelView = view * model;
+
+        m_Shader->use();
+        m_ModelViewMatrix.set(modelView);
+        m_ProjectionMatrix.set(projection);
+        m_NormalMatrix.set(glm::transpose(glm::inverse(glm::mat3(modelView))));
+        m_Range.set(glm::vec4(m_Minimum, m_Maximum, 0.0, 0.0));
+        m_Sampler.set(0);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_Texture);
+        glBindVertexArray(m_VAO);
+
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * m_Width, m_Height - 1);
+
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    inline unsigned int width() const { return m_Width; }
+    inline unsigned int height() const { return m_Height; }
+
+    // Bytes on the GPU, and sent by the last update().
+    inline size_t memory() const { return m_Values.size() * sizeof(float); }
+    inline size_t uploaded() const { return m_Uploaded; }
+
+private:
+    struct Rectangle
+    {
+        unsigned int X0;
+        unsigned int Y0;
+        unsigned int X1;
+        unsigned int Y1;
+    };
+
+    static std::string vertexShader()
+    {
+        return "                                                                                  \n\
+            #version 330                                                                          \n\
+                                                                                                  \n\
+            uniform sampler2D u_Values;                                                           \n\
+            uniform mat4 u_ModelViewMatrix;                                                       \n\
+            uniform mat4 u_ProjectionMatrix;                                                      \n\
+            uniform mat3 u_NormalMatrix;                                                          \n\
+            uniform vec4 u_Range;                                                                 \n\
+                                                                                                  \n\
+            out vec3 v_Position;                                                                  \n\
+            out vec3 v_Normal;                                                                    \n\
+            out float v_Value;                                                                    \n\
+                                                                                                  \n\
+            float value(ivec2 cell)                                                               \n\
+            {                                                                                     \n\
+                return texelFetch(u_Values, clamp(cell, ivec2(0), textureSize(u_Values, 0) - 1), 0).r; \n\
+            }                                                                                     \n\
+                                                                                                  \n\
+            void main(void)                                                                       \n\
+            {                                                                                     \n\
+                // Row strips : even vertices on row N, odd ones on row N + 1                     \n\
+                ivec2 cell = ivec2(gl_VertexID / 2, gl_InstanceID + gl_VertexID % 2);             \n\
+                float height = value(cell);                                                       \n\
+                                                                                                  \n\
+                float dx = value(cell + ivec2(1, 0)) - value(cell - ivec2(1, 0));                 \n\
+                float dz = value(cell + ivec2(0, 1)) - value(cell - ivec2(0, 1));                 \n\
+                vec3 normal = normalize(vec3(-dx, 2.0, -dz));                                     \n\
+                                                                                                  \n\
+                vec4 position = u_ModelViewMatrix * vec4(float(cell.x), height, float(cell.y), 1.0); \n\
+                v_Position = position.xyz;                                                        \n\
+                v_Normal = normalize(u_NormalMatrix * normal);                                    \n\
+                v_Value = u_Range.y > u_Range.x ? (height - u_Range.x) / (u_Range.y - u_Range.x) : 0.5; \n\
+                gl_Position = u_ProjectionMatrix * position;                                      \n\
+            }                                                                                     \n\
+        ";
+    }
+
+    static std::string fragmentShader()
+    {
+        return "                                                                                  \n\
+            #version 330                                                                          \n\
+                                                                                                  \n\
+            in vec3 v_Position;                                                                   \n\
+            in vec3 v_Normal;                                                                     \n\
+            in float v_Value;                                                                     \n\
+            out vec4 FragColor;                                                                   \n\
+                                                                                                  \n\
+            void main(void)                                                                       \n\
+            {                                                                                     \n\
+                vec3 low = vec3(0.05, 0.31, 0.55);                                                \n\
+                vec3 high = vec3(1.0, 0.56, 0.59);                                                \n\
+                float lambert = abs(dot(normalize(v_Normal), normalize(-v_Position)));            \n\
+                FragColor = vec4(mix(low, high, v_Value) * (0.3 + 0.7 * lambert), 1.0);           \n\
+            }                                                                                     \n\
+        ";
+    }
+
+    unsigned int m_Width;
+    unsigned int m_Height;
+    std::vector<float> m_Values;
+    std::vector<float> m_RowMinimum;
+    std::vector<float> m_RowMaximum;
+    float m_Minimum;
+    float m_Maximum;
+
+    Rectangle m_Dirty[MaxDirty];
+    unsigned int m_DirtyCount;
+    size_t m_Uploaded;
+
+    GLuint m_Texture;
+    GLuint m_VAO;
+
+    Shader::Program* m_Shader;
+    Uniforms::Location m_ModelViewMatrix;
+    Uniforms::Location m_ProjectionMatrix;
+    Uniforms::Location m_NormalMatrix;
+    Uniforms::Location m_Range;
+    Uniforms::Location m_Sampler;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include "Parallel.hh"
+
+// Batched translate * scale transforms.
+//
+// Inputs are kept as separate float arrays (SoA) so the inner loops vectorize, outputs are
+// the model matrices and view space normal matrices ready to upload.
+//
+// The normal matrix is transpose(inverse(mat3(view * parent * model))). For a rigid view and
+// parent (rotation + translation only) this reduces to mat3(view * parent) * diag(1 / scale),
+// which is what update() computes instead of a full 3x3 inverse per object. Uniform scale is
+// the special case where every column is divided by the same factor.
+
+class TransformBatch
+{
+public:
+    TransformBatch()
+    {
+    }
+
+    void resize(size_t count)
+    {
+        m_X.resize(count); m_Y.resize(count); m_Z.resize(count);
+        m_SX.resize(count, 1.0f); m_SY.resize(count, 1.0f); m_SZ.resize(count, 1.0f);
+        m_Models.resize(count);
+        m_Normals.resize(count);
+    }
+
+    inline void setTranslation(size_t i, const glm::vec3& t) { m_X[i] = t.x; m_Y[i] = t.y; m_Z[i] = t.z; }
+    inline void setScale(size_t i, const glm::vec3& s) { m_SX[i] = s.x; m_SY[i] = s.y; m_SZ[i] = s.z; }
+
+    void update(const glm::mat4& view, const glm::mat4& parent = glm::mat4(1.0))
+    {
+        const glm::mat3 rigid = glm::mat3(view * parent);
+
+        Parallel::forEach(size(), [&](size_t begin, size_t end)
+        {
+            update(begin, end, parent, rigid);
+        }, 1024);
+    }
+
+    inline size_t size() const { return m_X.size(); }
+
+    inline const glm::mat4& model(size_t i) const { return m_Models[i]; }
+    inline const glm::mat3& normal(size_t i) const { return m_Normals[i]; }
+
+    inline const std::vector<glm::mat4>& models() const { return m_Models; }
+    inline const std::vector<glm::mat3>& normals() const { return m_Normals; }
+
+private:
+    void update(size_t begin, size_t end, const glm::mat4& parent, const glm::mat3& rigid)
+    {
+        const float* x = m_X.data();
+        const float* y = m_Y.data();
+        const float* z = m_Z.data();
+        const float* sx = m_SX.data();
+        const float* sy = m_SY.data();
+        const float* sz = m_SZ.data();
+
+        float* models = reinterpret_cast<float*>(m_Models.data());
+        float* normals = reinterpret_cast<float*>(m_Normals.data());
+
+        const glm::vec4 p0 = parent[0], p1 = parent[1], p2 = parent[2], p3 = parent[3];
+        const glm::vec3 r0 = rigid[0], r1 = rigid[1], r2 = rigid[2];
+
+        // NOTE : Plain scalar arithmetic over flat arrays, written so the compiler can keep
+        // everything in registers and vectorize across objects.
+        for (size_t i = begin; i < end; i++)
+        {
+            float* m = models + 16 * i;
+
+            m[0]  = p0.x * sx[i]; m[1]  = p0.y * sx[i]; m[2]  = p0.z * sx[i]; m[3]  = p0.w * sx[i];
+            m[4]  = p1.x * sy[i]; m[5]  = p1.y * sy[i]; m[6]  = p1.z * sy[i]; m[7]  = p1.w * sy[i];
+            m[8]  = p2.x * sz[i]; m[9]  = p2.y * sz[i]; m[10] = p2.z * sz[i]; m[11] = p2.w * sz[i];
+            m[12] = p0.x * x[i] + p1.x * y[i] + p2.x * z[i] + p3.x;
+            m[13] = p0.y * x[i] + p1.y * y[i] + p2.y * z[i] + p3.y;
+            m[14] = p0.z * x[i] + p1.z * y[i] + p2.z * z[i] + p3.z;
+            m[15] = p0.w * x[i] + p1.w * y[i] + p2.w * z[i] + p3.w;
+
+            float* n = normals + 9 * i;
+            float ix = 1.0f / sx[i];
+            float iy = 1.0f / sy[i];
+            float iz = 1.0f / sz[i];
+
+            n[0] = r0.x * ix; n[1] = r0.y * ix; n[2] = r0.z * ix;
+            n[3] = r1.x * iy; n[4] = r1.y * iy; n[5] = r1.z * iy;
+            n[6] = r2.x * iz; n[7] = r2.y * iz; n[8] = r2.z * iz;
+        }
+    }
+
+    std::vector<float> m_X, m_Y, m_Z;
+    std::vector<float> m_SX, m_SY, m_SZ;
+
+    std::vector<glm::mat4> m_Models;
+    std::vector<glm::mat3> m_Normals;
+};
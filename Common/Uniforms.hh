@@ -0,0 +1,177 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+#include <raindance/Core/Camera/Camera.hh>
+#include <raindance/Core/Light.hh>
+#include <raindance/Core/Material.hh>
+
+#include <glm/gtc/type_ptr.hpp>
+
+// Uniform locations resolved once at link time, and std140 uniform blocks shared between
+// programs through fixed binding points. Neither does any string lookup per draw.
+//
+// Both take a GL program name. Shader::Program doesn't expose its own, so callers bind the
+// shader themselves and read it back with current() :
+//
+//     m_Shader->use();
+//     GLuint program = Uniforms::current();
+//     m_Color = Uniforms::Location(program, "u_Color");
+
+namespace Uniforms
+{
+    // Name of the program in use. Never binds anything, which program that is stays up to the caller.
+    inline GLuint current()
+    {
+        GLint id = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &id);
+        if (id == 0)
+            LOG("Uniforms : No program in use!\n");
+        return static_cast<GLuint>(id);
+    }
+
+    class Location
+    {
+    public:
+        Location()
+        {
+            m_Location = -1;
+        }
+
+        Location(GLuint program, const char* name)
+        {
+            m_Location = glGetUniformLocation(program, name);
+            if (m_Location < 0)
+                LOG("Uniform %s is not active!\n", name);
+        }
+
+        inline void set(int value) { glUniform1i(m_Location, value); }
+        inline void set(float value) { glUniform1f(m_Location, value); }
+        inline void set(const glm::vec3& value) { glUniform3fv(m_Location, 1, glm::value_ptr(value)); }
+        inline void set(const glm::vec4& value) { glUniform4fv(m_Location, 1, glm::value_ptr(value)); }
+        inline void set(const glm::mat3& value) { glUniformMatrix3fv(m_Location, 1, GL_FALSE, glm::value_ptr(value)); }
+        inline void set(const glm::mat4& value) { glUniformMatrix4fv(m_Location, 1, GL_FALSE, glm::value_ptr(value)); }
+
+        inline GLint location() const { return m_Location; }
+
+    private:
+        GLint m_Location;
+    };
+
+    enum Binding
+    {
+        CAMERA = 0,
+        LIGHT = 1,
+        MATERIAL = 2
+    };
+
+    // NOTE : The following structs mirror the std140 blocks declared in the shaders.
+
+    struct CameraBlock
+    {
+        glm::mat4 ViewMatrix;
+        glm::mat4 ProjectionMatrix;
+
+        void set(Camera& camera)
+        {
+            ViewMatrix = camera.getViewMatrix();
+            ProjectionMatrix = camera.getProjectionMatrix();
+        }
+    };
+
+    struct LightBlock
+    {
+        int Type;
+        int _Padding0[3];
+        glm::vec3 Position;
+        float _Padding1;
+        glm::vec3 Direction;
+        float _Padding2;
+        glm::vec3 Color;
+        float _Padding3;
+
+        void set(Light& light)
+        {
+            Type = light.getType();
+            Position = light.getPosition();
+            Direction = light.getDirection();
+            Color = light.getColor();
+        }
+    };
+
+    struct MaterialBlock
+    {
+        glm::vec3 Ambient;
+        float _Padding0;
+        glm::vec4 Diffuse;
+        glm::vec3 Specular;
+        float Shininess;
+    };
+
+    // Array of 'count' T's in one uniform buffer, each at an offset aligned for glBindBufferRange.
+    // A block with a single element is bound once to its binding point and then only updated.
+    template <typename T>
+    class Block
+    {
+    public:
+        Block(Binding binding, size_t count = 1)
+        {
+            GLint alignment = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+            m_Binding = binding;
+            m_Count = count;
+            m_Stride = (sizeof(T) + alignment - 1) / alignment * alignment;
+            m_Staging.resize(m_Stride * m_Count);
+
+            glGenBuffers(1, &m_Buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+            glBufferData(GL_UNIFORM_BUFFER, m_Stride * m_Count, NULL, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+            bindRange(0);
+        }
+
+        virtual ~Block()
+        {
+            glDeleteBuffers(1, &m_Buffer);
+        }
+
+        // Points the block named 'name' in 'program' at this block's binding point. Link-time only.
+        void attach(GLuint program, const char* name)
+        {
+            GLuint index = glGetUniformBlockIndex(program, name);
+            if (index == GL_INVALID_INDEX)
+            {
+                LOG("Uniform block %s is not active!\n", name);
+                return;
+            }
+            glUniformBlockBinding(program, index, m_Binding);
+        }
+
+        inline T& operator[](size_t index) { return *reinterpret_cast<T*>(&m_Staging[index * m_Stride]); }
+
+        void update()
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, m_Staging.size(), m_Staging.data());
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        inline void bindRange(size_t index)
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, m_Binding, m_Buffer, index * m_Stride, sizeof(T));
+        }
+
+        inline size_t size() const { return m_Count; }
+        inline GLuint id() const { return m_Buffer; }
+        inline Binding binding() const { return m_Binding; }
+        inline GLintptr offset(size_t index) const { return index * m_Stride; }
+
+    private:
+        Binding m_Binding;
+        size_t m_Count;
+        size_t m_Stride;
+        std::vector<unsigned char> m_Staging;
+        GLuint m_Buffer;
+    };
+}
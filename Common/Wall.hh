@@ -0,0 +1,219 @@
+#pragma once
+
+#include <raindance/Raindance.hh>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "Benchmark.hh"
+#include "Profiler.hh"
+#include "Redraw.hh"
+
+// Runs several windows at once, each one rendering on its own thread with its own context.
+//
+// Every context shares its objects with the first window's, so shaders, textures and buffers
+// loaded through the ResourceManager are uploaded once and usable from all windows. GL never
+// shares container objects (vertex arrays, framebuffers, queries), those stay per window.
+//
+// GLFW only processes events on the main thread : run() waits for events there and forwards
+// them. onKey() is thus called from the main thread and should only touch thread safe state
+// such as Redraw::invalidate(). reshape() is deferred to the window's own thread.
+//
+// NOTE : This would ideally be Raindance::run() itself. The run loop lives in the engine, so
+// samples drive rd::Window directly through Wall, the same way Benchmark::Runner does.
+
+class Wall
+{
+public:
+    typedef std::function<rd::Window* (rd::Window::Settings*)> Factory;
+
+    Wall()
+    {
+        m_Running = false;
+    }
+
+    virtual ~Wall()
+    {
+        for (auto slot : m_Slots)
+            delete slot;
+    }
+
+    void add(const rd::Window::Settings& settings, Factory factory)
+    {
+        Slot* slot = new Slot();
+        slot->Settings = settings;
+        slot->Create = factory;
+        slot->Handle = NULL;
+        slot->Window = NULL;
+        slot->Width = settings.Width;
+        slot->Height = settings.Height;
+        slot->Resized = true;
+        m_Slots.push_back(slot);
+    }
+
+    int run()
+    {
+        if (m_Slots.empty() || !glfwInit())
+            return EXIT_FAILURE;
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+
+        GLFWwindow* shared = NULL;
+        for (auto slot : m_Slots)
+        {
+            slot->Handle = glfwCreateWindow(slot->Settings.Width, slot->Settings.Height, slot->Settings.Title.c_str(), NULL, shared);
+            if (slot->Handle == NULL)
+            {
+                LOG("Wall : Failed to create window %s!\n", slot->Settings.Title.c_str());
+                glfwTerminate();
+                return EXIT_FAILURE;
+            }
+            if (shared == NULL)
+                shared = slot->Handle;
+            else
+                MemoryTracker::getInstance().share(slot->Handle, shared);
+
+            int width = 0;
+            int height = 0;
+            glfwGetFramebufferSize(slot->Handle, &width, &height);
+            slot->Width = width;
+            slot->Height = height;
+
+            glfwSetWindowUserPointer(slot->Handle, slot);
+            glfwSetKeyCallback(slot->Handle, onKey);
+            glfwSetFramebufferSizeCallback(slot->Handle, onResize);
+        }
+
+        // NOTE : GLEW entry points are process wide, loading them once from the first context is enough.
+        glfwMakeContextCurrent(shared);
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK)
+        {
+            LOG("Wall : Failed to initialize GLEW!\n");
+            glfwTerminate();
+            return EXIT_FAILURE;
+        }
+        glfwMakeContextCurrent(NULL);
+
+        Redraw::threaded() = true;
+        Profiler::gpu() = false;
+
+        m_Running = true;
+        for (auto slot : m_Slots)
+            slot->Thread = std::thread(&Wall::render, this, slot);
+
+        while (m_Running)
+        {
+            glfwWaitEvents();
+            for (auto slot : m_Slots)
+                if (glfwWindowShouldClose(slot->Handle))
+                    m_Running = false;
+        }
+
+        Redraw::shutdown();
+        for (auto slot : m_Slots)
+            slot->Thread.join();
+
+        for (auto slot : m_Slots)
+        {
+            LOG("Wall : %s, %lu frames, frame_ms %s\n", slot->Settings.Title.c_str(),
+                static_cast<unsigned long>(slot->Frames.Values.size()), slot->Frames.json().c_str());
+            glfwDestroyWindow(slot->Handle);
+        }
+        glfwTerminate();
+
+        return EXIT_SUCCESS;
+    }
+
+private:
+    struct Slot
+    {
+        rd::Window::Settings Settings;
+        Factory Create;
+
+        GLFWwindow* Handle;
+        std::atomic<rd::Window*> Window;
+        std::thread Thread;
+
+        std::atomic<int> Width;
+        std::atomic<int> Height;
+        std::atomic<bool> Resized;
+
+        Benchmark::Series Frames;
+    };
+
+    void render(Slot* slot)
+    {
+        glfwMakeContextCurrent(slot->Handle);
+        glfwSwapInterval(1);
+
+        Context context;
+
+        {
+            // NOTE : The ResourceManager isn't thread safe, windows load their resources one at a time.
+            std::lock_guard<std::mutex> lock(m_InitializeMutex);
+            rd::Window* window = slot->Create(&slot->Settings);
+            window->initialize(&context);
+            slot->Window = window;
+        }
+
+        rd::Window* window = slot->Window;
+        while (m_Running)
+        {
+            window->idle(&context);
+            if (!m_Running)
+                break;
+
+            auto start = Benchmark::Time::now();
+
+            if (slot->Resized.exchange(false))
+            {
+                glViewport(0, 0, slot->Width, slot->Height);
+                window->reshape(slot->Width, slot->Height);
+            }
+
+            window->draw(&context);
+
+            {
+                PROFILE_ZONE("Wall::swap");
+                glfwSwapBuffers(slot->Handle);
+            }
+
+            slot->Frames.push(Benchmark::milliseconds(start, Benchmark::Time::now()));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_InitializeMutex);
+            slot->Window = NULL;
+            delete window;
+        }
+
+        glfwMakeContextCurrent(NULL);
+    }
+
+    static void onKey(GLFWwindow* handle, int key, int scancode, int action, int mods)
+    {
+        Slot* slot = static_cast<Slot*>(glfwGetWindowUserPointer(handle));
+        rd::Window* window = slot->Window;
+        if (window != NULL)
+            window->onKey(key, scancode, action, mods);
+    }
+
+    static void onResize(GLFWwindow* handle, int width, int height)
+    {
+        Slot* slot = static_cast<Slot*>(glfwGetWindowUserPointer(handle));
+        slot->Width = width;
+        slot->Height = height;
+        slot->Resized = true;
+        Redraw::wakeAll();
+    }
+
+    std::vector<Slot*> m_Slots;
+    std::atomic<bool> m_Running;
+    std::mutex m_InitializeMutex;
+};
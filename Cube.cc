@@ -4,6 +4,12 @@
 #include <raindance/Core/Primitives/Cube.hh>
 #include <raindance/Core/FS.hh>
 
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Memory.hh"
+#include "Common/Profiler.hh"
+#include "Common/Redraw.hh"
+
 class DemoWindow : public rd::Window
 {
 public:
@@ -30,6 +36,8 @@ public:
         m_Camera.setPerspectiveProjection(60.0f, viewport.getDimension()[0] / viewport.getDimension()[1], 0.1f, 1024.0f);
         m_Camera.lookAt(glm::vec3(1, 2, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
 
+        MEMORY_SCOPE("Cube");
+
         m_Cube = new Cube();
         m_Cube->getLineVertexBuffer().mute("a_Normal", true);
 
@@ -55,25 +63,57 @@ public:
 
     void draw(Context* context) override
     {
+        PROFILE_GPU_ZONE("Window::draw");
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
      
         Transformation transformation;
 
         transformation.translate(glm::vec3(-1, 0, 0));
-        m_Cube->draw(context, m_Camera, transformation, m_Shader1, Cube::TRIANGLES);
+        {
+            PROFILE_GPU_ZONE("Cube::draw");
+            m_Cube->draw(context, m_Camera, transformation, m_Shader1, Cube::TRIANGLES);
+        }
         
         transformation.translate(glm::vec3(+2, 0, 0));
-        m_Cube->draw(context, m_Camera, transformation, m_Shader2, Cube::LINES);
+        {
+            PROFILE_GPU_ZONE("Cube::draw");
+            m_Cube->draw(context, m_Camera, transformation, m_Shader2, Cube::LINES);
+        }
 
         checkGLErrors();
+
+        Profiler::getInstance().frame(context);
+    }
+
+    void reshape(int width, int height) override
+    {
+        m_Camera.resize(width, height);
+        m_Redraw.invalidate();
+    }
+
+    void onKey(int key, int scancode, int action, int mods) override
+    {
+        (void) key;
+        (void) scancode;
+        (void) action;
+        (void) mods;
+
+        m_Redraw.invalidate();
     }
 
     void idle(Context* context) override
     {
+        m_Redraw.wait();
+
+        PROFILE_ZONE("Window::idle");
+
         (void) context;
     }
 
 private:
+    Redraw m_Redraw;
+
     Camera m_Camera;
     Cube* m_Cube;
     Shader::Program* m_Shader1;
@@ -82,13 +122,19 @@ private:
 
 int main(int argc, char** argv)
 {
-    auto demo = new Raindance(argc, argv);
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+    Redraw::configure(argc, argv);
 
     rd::Window::Settings settings;
     settings.Title = std::string("Cube");
     settings.Width = 1024;
     settings.Height = 728;
 
+    if (benchmark.headless())
+        return benchmark.run<DemoWindow>(settings);
+
+    auto demo = new Raindance(argc, argv);
     demo->add(new DemoWindow(&settings));
     demo->run();
     
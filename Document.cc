@@ -0,0 +1,470 @@
+#include <raindance/Raindance.hh>
+#include <raindance/Core/Camera/Camera.hh>
+#include <raindance/Core/Transformation.hh>
+#include <raindance/Core/FS.hh>
+
+#include <chrono>
+#include <cstddef>
+
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Profiler.hh"
+
+// A flat list of UI rectangles packed in one vertex buffer.
+// The same buffer feeds both the original geometry shader path (one point per rectangle,
+// expanded by Assets/interface_document.geom) and the instanced path (one unit quad
+// instanced per rectangle). Only blocks touched since the last update() are re-uploaded.
+//
+// document [--count N] [--benchmark FRAMES] [--updates random|local]
+//
+// Each frame recolors 1% of the rectangles, either scattered at random or as one contiguous
+// run moving through the document, the way edits to a real layout cluster.
+
+class Document
+{
+public:
+    struct Rectangle
+    {
+        glm::vec3 Position;
+        glm::vec3 Dimension;
+        glm::vec4 Color;
+    };
+
+    enum Mode
+    {
+        GEOMETRY_SHADER,
+        INSTANCED
+    };
+
+    // NOTE : 64 rectangles are 2.5 KB, small enough that scattered edits leave most blocks clean.
+    static const size_t BlockSize = 64;
+
+    // Clean gaps up to this many blocks are uploaded with their neighbours rather than split.
+    static const size_t MergeGap = 1;
+
+    Document(size_t capacity)
+    {
+        m_Rectangles.reserve(capacity);
+
+        m_ShaderGS = NULL;
+        m_ShaderInstanced = NULL;
+
+        {
+            FS::TextFile vert("Assets/interface_document.vert");
+            FS::TextFile geom("Assets/interface_document.geom");
+            FS::TextFile frag("Assets/interface_document.frag");
+            m_ShaderGS = ResourceManager::getInstance().loadShader("Document/document", vert.content(), frag.content(), geom.content());
+        }
+        {
+            FS::TextFile vert("Assets/interface_document_instanced.vert");
+            FS::TextFile frag("Assets/interface_document_instanced.frag");
+            m_ShaderInstanced = ResourceManager::getInstance().loadShader("Document/document_instanced", vert.content(), frag.content());
+        }
+
+        const float corners[] = { 0, 0,   1, 0,   0, 1,   1, 1 };
+
+        glGenBuffers(1, &m_RectangleVBO);
+        glGenBuffers(1, &m_CornerVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_CornerVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+        glGenVertexArrays(1, &m_VAOGS);
+        glGenVertexArrays(1, &m_VAOInstanced);
+
+        glBindVertexArray(m_VAOGS);
+        describeRectangles(0);
+
+        glBindVertexArray(m_VAOInstanced);
+        describeRectangles(1);
+        glBindBuffer(GL_ARRAY_BUFFER, m_CornerVBO);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*) 0);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        m_Allocated = 0;
+    }
+
+    virtual ~Document()
+    {
+        glDeleteVertexArrays(1, &m_VAOGS);
+        glDeleteVertexArrays(1, &m_VAOInstanced);
+        glDeleteBuffers(1, &m_RectangleVBO);
+        glDeleteBuffers(1, &m_CornerVBO);
+
+        ResourceManager::getInstance().unload(m_ShaderGS);
+        ResourceManager::getInstance().unload(m_ShaderInstanced);
+    }
+
+    size_t add(const Rectangle& rectangle)
+    {
+        m_Rectangles.push_back(rectangle);
+        touch(m_Rectangles.size() - 1);
+        return m_Rectangles.size() - 1;
+    }
+
+    void set(size_t index, const Rectangle& rectangle)
+    {
+        m_Rectangles[index] = rectangle;
+        touch(index);
+    }
+
+    inline Rectangle& get(size_t index) { return m_Rectangles[index]; }
+    inline void touch(size_t index)
+    {
+        size_t block = index / BlockSize;
+        if (block >= m_Dirty.size())
+            m_Dirty.resize(block + 1, true);
+        m_Dirty[block] = true;
+    }
+
+    // Uploads dirty blocks, merging runs separated by at most MergeGap clean blocks into a
+    // single glBufferSubData. Returns the number of bytes sent.
+    size_t update()
+    {
+        size_t bytes = 0;
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_RectangleVBO);
+
+        if (m_Allocated < m_Rectangles.capacity())
+        {
+            m_Allocated = m_Rectangles.capacity();
+            glBufferData(GL_ARRAY_BUFFER, m_Allocated * sizeof(Rectangle), NULL, GL_DYNAMIC_DRAW);
+            std::fill(m_Dirty.begin(), m_Dirty.end(), true);
+        }
+
+        size_t block = 0;
+        while (block < m_Dirty.size())
+        {
+            if (!m_Dirty[block])
+            {
+                block++;
+                continue;
+            }
+
+            size_t first = block;
+            size_t last = block;
+            while (block < m_Dirty.size() && block <= last + MergeGap + 1)
+            {
+                if (m_Dirty[block])
+                {
+                    m_Dirty[block] = false;
+                    last = block;
+                }
+                block++;
+            }
+            block = last + 1;
+
+            size_t begin = first * BlockSize;
+            size_t end = std::min(block * BlockSize, m_Rectangles.size());
+            if (begin < end)
+            {
+                glBufferSubData(GL_ARRAY_BUFFER, begin * sizeof(Rectangle), (end - begin) * sizeof(Rectangle), &m_Rectangles[begin]);
+                bytes += (end - begin) * sizeof(Rectangle);
+            }
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        return bytes;
+    }
+
+    void draw(Camera& camera, Transformation& transformation, Mode mode)
+    {
+        Shader::Program* shader = mode == GEOMETRY_SHADER ? m_ShaderGS : m_ShaderInstanced;
+
+        shader->use();
+        shader->uniform("u_ModelViewMatrix").set(camera.getViewMatrix() * transformation.state());
+        shader->uniform("u_ProjectionMatrix").set(camera.getProjectionMatrix());
+
+        if (mode == GEOMETRY_SHADER)
+        {
+            glBindVertexArray(m_VAOGS);
+            glDrawArrays(GL_POINTS, 0, m_Rectangles.size());
+        }
+        else
+        {
+            glBindVertexArray(m_VAOInstanced);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_Rectangles.size());
+        }
+
+        glBindVertexArray(0);
+    }
+
+    inline size_t size() const { return m_Rectangles.size(); }
+
+private:
+    void describeRectangles(GLuint divisor)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_RectangleVBO);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Rectangle), (void*) offsetof(Rectangle, Position));
+        glVertexAttribDivisor(0, divisor);
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Rectangle), (void*) offsetof(Rectangle, Dimension));
+        glVertexAttribDivisor(1, divisor);
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Rectangle), (void*) offsetof(Rectangle, Color));
+        glVertexAttribDivisor(2, divisor);
+    }
+
+    std::vector<Rectangle> m_Rectangles;
+    std::vector<bool> m_Dirty;
+    size_t m_Allocated;
+
+    Shader::Program* m_ShaderGS;
+    Shader::Program* m_ShaderInstanced;
+
+    GLuint m_RectangleVBO;
+    GLuint m_CornerVBO;
+    GLuint m_VAOGS;
+    GLuint m_VAOInstanced;
+};
+
+class DemoWindow : public rd::Window
+{
+public:
+    // NOTE : Timer results are read this many frames after their query, as Profiler does, so
+    // the measurement doesn't wait for the GPU to drain.
+    static const unsigned int QueryLatency = 3;
+
+    DemoWindow(rd::Window::Settings* settings, size_t count, unsigned int benchmark, bool local)
+    : Window(settings)
+    {
+        m_Document = NULL;
+        m_Count = count;
+        m_Mode = Document::INSTANCED;
+        m_Local = local;
+        m_Cursor = 0;
+
+        m_Benchmark = benchmark;
+        m_Frame = 0;
+        m_Reported = false;
+        for (unsigned int i = 0; i < QueryLatency; i++)
+        {
+            m_Queries[i] = 0;
+            m_Pending[i] = false;
+        }
+        m_GPUTime[0] = m_GPUTime[1] = 0;
+        m_CPUTime[0] = m_CPUTime[1] = 0;
+        m_Uploaded = 0;
+    }
+
+    virtual ~DemoWindow()
+    {
+        if (m_Queries[0])
+            glDeleteQueries(QueryLatency, m_Queries);
+        SAFE_DELETE(m_Document);
+    }
+
+    void initialize(Context* context) override
+    {
+        (void) context;
+
+        auto viewport = this->getViewport();
+        float width = viewport.getDimension()[0];
+        float height = viewport.getDimension()[1];
+
+        m_Camera.setOrthographicProjection(0, width, 0, height, -10.0, 10.0);
+        m_Camera.lookAt(glm::vec3(0, 0, 1.0), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+
+        m_Document = new Document(m_Count);
+
+        size_t columns = static_cast<size_t>(sqrt(m_Count * width / height)) + 1;
+        size_t rows = (m_Count + columns - 1) / columns;
+        glm::vec2 cell = glm::vec2(width / columns, height / rows);
+
+        for (size_t i = 0; i < m_Count; i++)
+        {
+            Document::Rectangle rectangle;
+            rectangle.Position = glm::vec3((i % columns) * cell.x, (i / columns) * cell.y, 0.0);
+            rectangle.Dimension = glm::vec3(0.8f * cell.x, 0.8f * cell.y, 0.0);
+            rectangle.Color = glm::vec4(RANDOM_FLOAT(0.0, 1.0), RANDOM_FLOAT(0.0, 1.0), RANDOM_FLOAT(0.0, 1.0), 1.0);
+            m_Document->add(rectangle);
+        }
+        m_Document->update();
+
+        glGenQueries(QueryLatency, m_Queries);
+
+        glClearColor(0.2, 0.2, 0.2, 1.0);
+        glDisable(GL_DEPTH_TEST);
+    }
+
+    void draw(Context* context) override
+    {
+        PROFILE_GPU_ZONE("Window::draw");
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        Transformation transformation;
+
+        bool measure = m_Benchmark > 0 && m_Frame < 2 * m_Benchmark;
+        if (measure)
+            m_Mode = m_Frame < m_Benchmark ? Document::GEOMETRY_SHADER : Document::INSTANCED;
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        unsigned int slot = m_Frame % QueryLatency;
+        if (measure)
+        {
+            if (m_Pending[slot])
+                resolve(slot, true);
+            m_QueryMode[slot] = m_Mode;
+            glBeginQuery(GL_TIME_ELAPSED, m_Queries[slot]);
+        }
+
+        m_Uploaded += m_Document->update();
+        {
+            PROFILE_GPU_ZONE("Document::draw");
+            m_Document->draw(m_Camera, transformation, m_Mode);
+        }
+
+        if (measure)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            m_Pending[slot] = true;
+            m_CPUTime[m_Mode] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            m_Frame++;
+        }
+
+        if (m_Benchmark > 0 && m_Frame >= 2 * m_Benchmark)
+        {
+            bool pending = false;
+            for (unsigned int i = 0; i < QueryLatency; i++)
+                if (m_Pending[i])
+                    pending |= !resolve(i, false);
+            if (!pending && !m_Reported)
+            {
+                report();
+                m_Reported = true;
+            }
+        }
+
+        Profiler::getInstance().frame(context);
+    }
+
+    void idle(Context* context) override
+    {
+        PROFILE_ZONE("Window::idle");
+
+        (void) context;
+
+        // NOTE : Recolor 1% of the rectangles per frame so update() has partial work to do
+        for (size_t i = 0; i < m_Count / 100; i++)
+        {
+            size_t index = m_Local ? m_Cursor++ % m_Document->size() : rand() % m_Document->size();
+            m_Document->get(index).Color = glm::vec4(RANDOM_FLOAT(0.0, 1.0), RANDOM_FLOAT(0.0, 1.0), RANDOM_FLOAT(0.0, 1.0), 1.0);
+            m_Document->touch(index);
+        }
+    }
+
+    void onKey(int key, int scancode, int action, int mods) override
+    {
+        (void) scancode;
+        (void) mods;
+
+        if (action == GLFW_PRESS && key == GLFW_KEY_SPACE)
+        {
+            m_Mode = m_Mode == Document::INSTANCED ? Document::GEOMETRY_SHADER : Document::INSTANCED;
+            LOG("Mode : %s\n", m_Mode == Document::INSTANCED ? "instanced" : "geometry shader");
+        }
+    }
+
+    // Adds the result of the query in 'slot' to its mode's total. Unless 'wait' is set, returns
+    // false without blocking when the GPU hasn't finished it yet.
+    bool resolve(unsigned int slot, bool wait)
+    {
+        if (!wait)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(m_Queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return false;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_Queries[slot], GL_QUERY_RESULT, &elapsed);
+        m_GPUTime[m_QueryMode[slot]] += elapsed;
+        m_Pending[slot] = false;
+        return true;
+    }
+
+    void report()
+    {
+        const char* names[] = { "geometry shader", "instanced" };
+        for (int mode = 0; mode < 2; mode++)
+        {
+            double gpu = m_GPUTime[mode] / 1e6 / m_Benchmark;
+            LOG("%s : %lu rectangles, %u frames, gpu %.3f ms/frame, cpu %.3f ms/frame, %.2f Mrect/s\n",
+                names[mode], static_cast<unsigned long>(m_Count), m_Benchmark,
+                gpu, m_CPUTime[mode] / m_Benchmark,
+                m_Count / gpu / 1e3);
+        }
+        LOG("uploaded : %.2f KB/frame, %s updates\n", m_Uploaded / 1024.0 / (2 * m_Benchmark), m_Local ? "local" : "random");
+    }
+
+private:
+    Camera m_Camera;
+    Document* m_Document;
+    Document::Mode m_Mode;
+    size_t m_Count;
+    bool m_Local;
+    size_t m_Cursor;
+
+    unsigned int m_Benchmark;
+    unsigned int m_Frame;
+    bool m_Reported;
+    GLuint m_Queries[QueryLatency];
+    Document::Mode m_QueryMode[QueryLatency];
+    bool m_Pending[QueryLatency];
+    GLuint64 m_GPUTime[2];
+    double m_CPUTime[2];
+    size_t m_Uploaded;
+};
+
+int main(int argc, char** argv)
+{
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+
+    size_t count = 100000;
+    unsigned int comparison = 0;
+    bool local = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc)
+            count = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--benchmark" && i + 1 < argc)
+            comparison = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--updates" && i + 1 < argc)
+            local = std::string(argv[++i]) == "local";
+    }
+
+    rd::Window::Settings settings;
+    settings.Title = std::string("Document");
+    settings.Width = 1024;
+    settings.Height = 728;
+
+    if (benchmark.headless())
+    {
+        if (!benchmark.open(settings))
+            return EXIT_FAILURE;
+
+        DemoWindow window(&settings, count, comparison, local);
+        return benchmark.run(&window);
+    }
+
+    auto demo = new Raindance(argc, argv);
+    demo->add(new DemoWindow(&settings, count, comparison, local));
+    demo->run();
+
+    delete demo;
+
+    return 0;
+}
@@ -4,6 +4,11 @@
 #include <raindance/Core/Text.hh>
 #include <raindance/Core/Font.hh>
 
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Profiler.hh"
+#include "Common/Redraw.hh"
+
 class DemoWindow : public rd::Window
 {
 public:
@@ -32,6 +37,8 @@ public:
 
     virtual void draw(Context* context)
     {
+        PROFILE_GPU_ZONE("Window::draw");
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
         glDisable(GL_DEPTH_TEST);
@@ -51,18 +58,47 @@ public:
             color.a = 1.0;
 
             m_Text.setColor(color);
-            m_Text.draw(*context, m_Camera.getProjectionMatrix() * m_Camera.getViewMatrix() * transformation.state());
+            {
+                PROFILE_GPU_ZONE("Text::draw");
+                m_Text.draw(*context, m_Camera.getProjectionMatrix() * m_Camera.getViewMatrix() * transformation.state());
+            }
             transformation.translate(glm::vec3(0, m_Font->getSize(), 0.0));
             transformation.scale(glm::vec3(1.05, 1.05, 1.0));
         }
+
+        Profiler::getInstance().frame(context);
+    }
+
+    virtual void reshape(int width, int height)
+    {
+        (void) width;
+        (void) height;
+
+        m_Redraw.invalidate();
+    }
+
+    virtual void onKey(int key, int scancode, int action, int mods)
+    {
+        (void) key;
+        (void) scancode;
+        (void) action;
+        (void) mods;
+
+        m_Redraw.invalidate();
     }
 
     virtual void idle(Context* context)
     {
+        m_Redraw.wait();
+
+        PROFILE_ZONE("Window::idle");
+
         (void) context;
     }
 
 private:
+    Redraw m_Redraw;
+
     Camera m_Camera;
 
     Text m_Text;
@@ -71,13 +107,19 @@ private:
 
 int main(int argc, char** argv)
 {
-    auto demo = new Raindance(argc, argv);
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+    Redraw::configure(argc, argv);
 
     rd::Window::Settings settings;
     settings.Title = std::string("Fonts");
     settings.Width = 1024;
     settings.Height = 728;
 
+    if (benchmark.headless())
+        return benchmark.run<DemoWindow>(settings);
+
+    auto demo = new Raindance(argc, argv);
     demo->add(new DemoWindow(&settings));
     demo->run();
 
@@ -0,0 +1,681 @@
+#include <raindance/Raindance.hh>
+#include <raindance/Core/Camera/Camera.hh>
+#include <raindance/Core/Transformation.hh>
+#include <raindance/Core/Icon.hh>
+#include <raindance/Core/FS.hh>
+
+#include <chrono>
+#include <cstring>
+
+#ifdef RD_OPENCL
+#include <CL/cl.h>
+#endif
+
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Graph.hh"
+#include "Common/Profiler.hh"
+#include "Common/Parallel.hh"
+#include "Common/StreamingBuffer.hh"
+
+// particles [--count N] [--opencl] [--benchmark UPDATES] [--graph NODES [--links M]]
+//
+// --graph lays out a Barabasi-Albert graph with the force directed kernels of
+// Assets/particles_physics.cl instead of running the sine wave, one particle per node.
+
+// NOTE : Must match the Instance struct of Assets/particles_physics.cl
+struct Instance
+{
+    glm::vec4 Translation;
+    glm::vec4 Scale;
+    glm::vec4 Color;
+};
+
+class Simulation
+{
+public:
+    virtual ~Simulation() {}
+    virtual const char* name() = 0;
+    virtual void update(std::vector<Instance>& instances, float time) = 0;
+};
+
+// CPU port of the sine_wave kernel.
+// cos(id) and id mod 2PI are invariant per particle and get precomputed in SoA arrays,
+// which leaves a single cosine per particle that the compiler can vectorize.
+class SineWaveCPU : public Simulation
+{
+public:
+    SineWaveCPU(size_t count)
+    {
+        m_Phase.resize(count);
+        m_Offset.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            m_Phase[i] = static_cast<float>(cos(static_cast<double>(i)));
+            m_Offset[i] = static_cast<float>(fmod(static_cast<double>(i), 2 * M_PI));
+        }
+    }
+
+    const char* name() override { return "cpu"; }
+
+    void update(std::vector<Instance>& instances, float time) override
+    {
+        Instance* data = instances.data();
+        const float* phase = m_Phase.data();
+        const float* offset = m_Offset.data();
+
+        Parallel::forEach(instances.size(), [=](size_t begin, size_t end)
+        {
+            const size_t block = 256;
+            float x[block];
+
+            for (size_t first = begin; first < end; first += block)
+            {
+                size_t n = std::min(block, end - first);
+
+                for (size_t i = 0; i < n; i++)
+                    x[i] = 200.0f * fastCos(phase[first + i] * time / 2 + offset[first + i]);
+
+                for (size_t i = 0; i < n; i++)
+                    data[first + i].Translation.x = x[i];
+            }
+        }, 256);
+    }
+
+    static inline float fastCos(float x)
+    {
+        const float twoPi = static_cast<float>(2 * M_PI);
+        const float invTwoPi = static_cast<float>(1.0 / (2 * M_PI));
+
+        // NOTE : Round to nearest through an integer conversion so the loop vectorizes without SSE4.1
+        float k = static_cast<float>(static_cast<int>(x * invTwoPi + (x >= 0 ? 0.5f : -0.5f)));
+        x -= k * twoPi;
+
+        float x2 = x * x;
+        return 1.0f + x2 * (-1.0f / 2 + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320 + x2 * (-1.0f / 3628800 + x2 * (1.0f / 479001600))))));
+    }
+
+private:
+    std::vector<float> m_Phase;
+    std::vector<float> m_Offset;
+};
+
+#ifdef RD_OPENCL
+// Context, queue and Assets/particles_physics.cl built for the first GPU, or any device.
+class PhysicsProgram
+{
+public:
+    PhysicsProgram()
+    {
+        Context = NULL;
+        Queue = NULL;
+        Program = NULL;
+    }
+
+    virtual ~PhysicsProgram()
+    {
+        if (Program) clReleaseProgram(Program);
+        if (Queue) clReleaseCommandQueue(Queue);
+        if (Context) clReleaseContext(Context);
+    }
+
+    bool initialize()
+    {
+        cl_platform_id platform;
+        cl_device_id device;
+        cl_int error;
+
+        if (clGetPlatformIDs(1, &platform, NULL) != CL_SUCCESS)
+            return false;
+        if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, NULL) != CL_SUCCESS &&
+            clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 1, &device, NULL) != CL_SUCCESS)
+            return false;
+
+        Context = clCreateContext(NULL, 1, &device, NULL, NULL, &error);
+        if (error != CL_SUCCESS)
+            return false;
+
+        Queue = clCreateCommandQueue(Context, device, 0, &error);
+        if (error != CL_SUCCESS)
+            return false;
+
+        FS::TextFile source("Assets/particles_physics.cl");
+        std::string content = source.content();
+        const char* text = content.c_str();
+        Program = clCreateProgramWithSource(Context, 1, &text, NULL, &error);
+        if (error != CL_SUCCESS || clBuildProgram(Program, 1, &device, NULL, NULL, NULL) != CL_SUCCESS)
+        {
+            LOG("Failed to build Assets/particles_physics.cl!\n");
+            return false;
+        }
+        return true;
+    }
+
+    cl_context Context;
+    cl_command_queue Queue;
+    cl_program Program;
+};
+
+class SineWaveCL : public Simulation
+{
+public:
+    SineWaveCL()
+    {
+        m_Kernel = NULL;
+        m_Instances = NULL;
+    }
+
+    virtual ~SineWaveCL()
+    {
+        if (m_Instances) clReleaseMemObject(m_Instances);
+        if (m_Kernel) clReleaseKernel(m_Kernel);
+    }
+
+    bool initialize(std::vector<Instance>& instances)
+    {
+        cl_int error;
+
+        if (!m_CL.initialize())
+            return false;
+
+        m_Kernel = clCreateKernel(m_CL.Program, "sine_wave", &error);
+        if (error != CL_SUCCESS)
+            return false;
+
+        m_Instances = clCreateBuffer(m_CL.Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, instances.size() * sizeof(Instance), instances.data(), &error);
+        return error == CL_SUCCESS;
+    }
+
+    const char* name() override { return "opencl"; }
+
+    void update(std::vector<Instance>& instances, float time) override
+    {
+        size_t global = instances.size();
+
+        clSetKernelArg(m_Kernel, 0, sizeof(cl_mem), &m_Instances);
+        clSetKernelArg(m_Kernel, 1, sizeof(float), &time);
+        clEnqueueNDRangeKernel(m_CL.Queue, m_Kernel, 1, NULL, &global, NULL, 0, NULL, NULL);
+        clEnqueueReadBuffer(m_CL.Queue, m_Instances, CL_TRUE, 0, instances.size() * sizeof(Instance), instances.data(), 0, NULL, NULL);
+    }
+
+private:
+    PhysicsProgram m_CL;
+    cl_kernel m_Kernel;
+    cl_mem m_Instances;
+};
+#endif
+
+// Force directed layout of a graph whose nodes are the particles : all pairs repulse, edges
+// attract, then every node moves a 'temperature' long step along its force. The temperature
+// cools down so the layout settles.
+class ForceLayout : public Simulation
+{
+public:
+    static constexpr float K = 30.0f;
+
+    ForceLayout(std::vector<Instance>& instances, const std::vector<CSR::Edge>& edges)
+    {
+        m_CSR.build(instances.size(), edges);
+        m_Nodes.resize(instances.size());
+        m_Directions.resize(instances.size());
+        m_Temperature = 10.0f;
+    }
+
+    virtual ~ForceLayout() {}
+
+    const char* name() override { return "layout cpu"; }
+
+    void update(std::vector<Instance>& instances, float time) override
+    {
+        (void) time;
+
+        for (size_t i = 0; i < instances.size(); i++)
+            m_Nodes[i] = instances[i].Translation;
+
+        Layout::repulsion(m_Nodes, K, m_Directions);
+        Layout::attraction(m_Nodes, m_CSR, K, m_Directions);
+        Layout::movement(m_Nodes, m_Directions, cool());
+
+        for (size_t i = 0; i < instances.size(); i++)
+            instances[i].Translation = m_Nodes[i];
+    }
+
+protected:
+    float cool()
+    {
+        float temperature = m_Temperature;
+        m_Temperature = std::max(0.5f, m_Temperature * 0.995f);
+        return temperature;
+    }
+
+    CSR m_CSR;
+    std::vector<glm::vec4> m_Nodes;
+    std::vector<glm::vec4> m_Directions;
+    float m_Temperature;
+};
+
+#ifdef RD_OPENCL
+class ForceLayoutCL : public ForceLayout
+{
+public:
+    ForceLayoutCL(std::vector<Instance>& instances, const std::vector<CSR::Edge>& edges)
+    : ForceLayout(instances, edges)
+    {
+        m_Repulsion = m_Attraction = m_Movement = NULL;
+        m_NodesCL = m_DirectionsCL = m_OffsetsCL = m_NeighborsCL = NULL;
+    }
+
+    virtual ~ForceLayoutCL()
+    {
+        cl_mem buffers[] = { m_NodesCL, m_DirectionsCL, m_OffsetsCL, m_NeighborsCL };
+        for (auto buffer : buffers)
+            if (buffer) clReleaseMemObject(buffer);
+
+        cl_kernel kernels[] = { m_Repulsion, m_Attraction, m_Movement };
+        for (auto kernel : kernels)
+            if (kernel) clReleaseKernel(kernel);
+    }
+
+    bool initialize(std::vector<Instance>& instances)
+    {
+        cl_int error;
+
+        if (!m_CL.initialize())
+            return false;
+
+        m_Repulsion = clCreateKernel(m_CL.Program, "repulsion", &error);
+        if (error != CL_SUCCESS)
+            return false;
+        m_Attraction = clCreateKernel(m_CL.Program, "attraction", &error);
+        if (error != CL_SUCCESS)
+            return false;
+        m_Movement = clCreateKernel(m_CL.Program, "movement", &error);
+        if (error != CL_SUCCESS)
+            return false;
+
+        for (size_t i = 0; i < instances.size(); i++)
+            m_Nodes[i] = instances[i].Translation;
+
+        // NOTE : The CSR is uploaded once, the attraction kernel gathers each node's forces over its neighbor range.
+        auto& offsets = m_CSR.offsets();
+        auto& neighbors = m_CSR.neighbors();
+
+        m_NodesCL = clCreateBuffer(m_CL.Context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, m_Nodes.size() * sizeof(glm::vec4), m_Nodes.data(), &error);
+        if (error != CL_SUCCESS)
+            return false;
+        m_DirectionsCL = clCreateBuffer(m_CL.Context, CL_MEM_READ_WRITE, m_Nodes.size() * sizeof(glm::vec4), NULL, &error);
+        if (error != CL_SUCCESS)
+            return false;
+        m_OffsetsCL = clCreateBuffer(m_CL.Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, offsets.size() * sizeof(cl_uint), const_cast<unsigned int*>(offsets.data()), &error);
+        if (error != CL_SUCCESS)
+            return false;
+        m_NeighborsCL = clCreateBuffer(m_CL.Context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, std::max<size_t>(1, neighbors.size()) * sizeof(cl_uint), const_cast<unsigned int*>(neighbors.data()), &error);
+        if (error != CL_SUCCESS)
+            return false;
+
+        cl_ulong count = m_Nodes.size();
+        float k = K;
+
+        clSetKernelArg(m_Repulsion, 0, sizeof(cl_mem), &m_NodesCL);
+        clSetKernelArg(m_Repulsion, 1, sizeof(cl_mem), &m_DirectionsCL);
+        clSetKernelArg(m_Repulsion, 2, sizeof(cl_ulong), &count);
+        clSetKernelArg(m_Repulsion, 3, sizeof(float), &k);
+
+        clSetKernelArg(m_Attraction, 0, sizeof(cl_mem), &m_NodesCL);
+        clSetKernelArg(m_Attraction, 1, sizeof(cl_mem), &m_OffsetsCL);
+        clSetKernelArg(m_Attraction, 2, sizeof(cl_mem), &m_NeighborsCL);
+        clSetKernelArg(m_Attraction, 3, sizeof(cl_mem), &m_DirectionsCL);
+        clSetKernelArg(m_Attraction, 4, sizeof(float), &k);
+
+        clSetKernelArg(m_Movement, 0, sizeof(cl_mem), &m_NodesCL);
+        clSetKernelArg(m_Movement, 1, sizeof(cl_mem), &m_DirectionsCL);
+        clSetKernelArg(m_Movement, 2, sizeof(cl_mem), &m_NodesCL);
+        return true;
+    }
+
+    const char* name() override { return "layout opencl"; }
+
+    void update(std::vector<Instance>& instances, float time) override
+    {
+        (void) time;
+
+        size_t global = instances.size();
+        float temperature = cool();
+
+        // NOTE : One in-order queue, attraction adds to what repulsion wrote.
+        clSetKernelArg(m_Movement, 3, sizeof(float), &temperature);
+        clEnqueueNDRangeKernel(m_CL.Queue, m_Repulsion, 1, NULL, &global, NULL, 0, NULL, NULL);
+        clEnqueueNDRangeKernel(m_CL.Queue, m_Attraction, 1, NULL, &global, NULL, 0, NULL, NULL);
+        clEnqueueNDRangeKernel(m_CL.Queue, m_Movement, 1, NULL, &global, NULL, 0, NULL, NULL);
+        clEnqueueReadBuffer(m_CL.Queue, m_NodesCL, CL_TRUE, 0, m_Nodes.size() * sizeof(glm::vec4), m_Nodes.data(), 0, NULL, NULL);
+
+        for (size_t i = 0; i < instances.size(); i++)
+            instances[i].Translation = m_Nodes[i];
+    }
+
+private:
+    PhysicsProgram m_CL;
+    cl_kernel m_Repulsion;
+    cl_kernel m_Attraction;
+    cl_kernel m_Movement;
+    cl_mem m_NodesCL;
+    cl_mem m_DirectionsCL;
+    cl_mem m_OffsetsCL;
+    cl_mem m_NeighborsCL;
+};
+#endif
+
+class ParticleSystem
+{
+public:
+    ParticleSystem(size_t count, bool opencl, unsigned int links)
+    {
+        m_Instances.resize(count);
+        for (auto& instance : m_Instances)
+        {
+            instance.Translation = glm::vec4(RANDOM_FLOAT(-200.0, 200.0), RANDOM_FLOAT(-200.0, 200.0), RANDOM_FLOAT(-200.0, 200.0), 1.0);
+            instance.Scale = glm::vec4(1.0, 1.0, 1.0, 1.0);
+            instance.Color = glm::vec4(RANDOM_FLOAT(0.2, 1.0), RANDOM_FLOAT(0.2, 1.0), RANDOM_FLOAT(0.2, 1.0), 0.5);
+        }
+
+        m_Simulation = NULL;
+
+        if (links > 0)
+        {
+            std::vector<CSR::Edge> edges = Graph::barabasiAlbert(count, links);
+            LOG("Graph : %lu nodes, %lu edges\n", static_cast<unsigned long>(count), static_cast<unsigned long>(edges.size()));
+#ifdef RD_OPENCL
+            if (opencl)
+            {
+                auto layout = new ForceLayoutCL(m_Instances, edges);
+                if (layout->initialize(m_Instances))
+                    m_Simulation = layout;
+                else
+                {
+                    LOG("OpenCL is not available, falling back to CPU!\n");
+                    delete layout;
+                }
+            }
+#endif
+            if (m_Simulation == NULL)
+                m_Simulation = new ForceLayout(m_Instances, edges);
+            return;
+        }
+
+#ifdef RD_OPENCL
+        if (opencl)
+        {
+            auto simulation = new SineWaveCL();
+            if (simulation->initialize(m_Instances))
+                m_Simulation = simulation;
+            else
+            {
+                LOG("OpenCL is not available, falling back to CPU!\n");
+                delete simulation;
+            }
+        }
+#else
+        if (opencl)
+            LOG("Built without OpenCL support, falling back to CPU!\n");
+#endif
+
+        if (m_Simulation == NULL)
+            m_Simulation = new SineWaveCPU(count);
+    }
+
+    virtual ~ParticleSystem()
+    {
+        SAFE_DELETE(m_Simulation);
+    }
+
+    inline void update(float time) { m_Simulation->update(m_Instances, time); }
+
+    inline std::vector<Instance>& instances() { return m_Instances; }
+    inline Simulation& simulation() { return *m_Simulation; }
+
+private:
+    std::vector<Instance> m_Instances;
+    Simulation* m_Simulation;
+};
+
+class DemoWindow : public rd::Window
+{
+public:
+    DemoWindow(rd::Window::Settings* settings, ParticleSystem* particles)
+    : Window(settings)
+    {
+        m_Particles = particles;
+        m_Shader = NULL;
+        m_Icon = NULL;
+        m_VAO = 0;
+        m_QuadVBO = 0;
+        m_InstanceStream = NULL;
+    }
+
+    virtual ~DemoWindow()
+    {
+        if (m_InstanceStream)
+            m_InstanceStream->dump("Particles/instances");
+        SAFE_DELETE(m_InstanceStream);
+        glDeleteBuffers(1, &m_QuadVBO);
+        glDeleteVertexArrays(1, &m_VAO);
+
+        SAFE_DELETE(m_Icon);
+        ResourceManager::getInstance().unload(m_Shader);
+    }
+
+    void initialize(Context* context) override
+    {
+        (void) context;
+
+        auto viewport = this->getViewport();
+        m_Camera.setPerspectiveProjection(60.0f, viewport.getDimension()[0] / viewport.getDimension()[1], 0.1f, 2048.0f);
+        m_Camera.lookAt(glm::vec3(0, 0, 500), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+
+        {
+            FS::TextFile vert("Assets/particles_instanced.vert");
+            FS::TextFile frag("Assets/particles_instanced.frag");
+            m_Shader = ResourceManager::getInstance().loadShader("Particles/instanced", vert.content(), frag.content());
+            m_Shader->dump();
+        }
+
+        m_Icon = new Icon();
+        m_Icon->load("Particles/icon", FS::BinaryFile("Assets/particles_icon.png"));
+
+        // NOTE : a_Position (vec3) followed by a_UV (vec2), drawn as a triangle strip
+        const float quad[] =
+        {
+            -0.5f, -0.5f, 0.0f,    0.0f, 0.0f,
+            +0.5f, -0.5f, 0.0f,    1.0f, 0.0f,
+            -0.5f, +0.5f, 0.0f,    0.0f, 1.0f,
+            +0.5f, +0.5f, 0.0f,    1.0f, 1.0f
+        };
+
+        glGenVertexArrays(1, &m_VAO);
+        glBindVertexArray(m_VAO);
+
+        glGenBuffers(1, &m_QuadVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_QuadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*) 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*) (3 * sizeof(float)));
+
+        m_InstanceStream = new StreamingBuffer(GL_ARRAY_BUFFER, m_Particles->instances().size() * sizeof(Instance));
+        for (GLuint i = 0; i < 3; i++)
+        {
+            glEnableVertexAttribArray(2 + i);
+            glVertexAttribDivisor(2 + i, 1);
+        }
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glClearColor(0.05, 0.05, 0.05, 1.0);
+        glDisable(GL_DEPTH_TEST);
+
+        m_Clock.reset();
+    }
+
+    void reshape(int width, int height) override
+    {
+        m_Camera.resize(width, height);
+    }
+
+    void draw(Context* context) override
+    {
+        PROFILE_GPU_ZONE("Window::draw");
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        auto& instances = m_Particles->instances();
+
+        // NOTE : No region to write this frame, the particles are skipped rather than drawn from stale data.
+        void* data = m_InstanceStream->map();
+        if (data != NULL)
+        {
+            memcpy(data, instances.data(), instances.size() * sizeof(Instance));
+            m_InstanceStream->unmap();
+            drawInstances(instances.size());
+        }
+
+        checkGLErrors();
+
+        Profiler::getInstance().frame(context);
+    }
+
+    void idle(Context* context) override
+    {
+        PROFILE_ZONE("Window::idle");
+
+        (void) context;
+
+        PROFILE_ZONE("Particles::update");
+        m_Particles->update(m_Clock.seconds());
+    }
+
+private:
+    // Draws 'count' instances from the streaming buffer's current region, then fences it.
+    void drawInstances(size_t count)
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+
+        Transformation transformation;
+
+        m_Shader->use();
+        m_Shader->uniform("u_ModelViewMatrix").set(m_Camera.getViewMatrix() * transformation.state());
+        m_Shader->uniform("u_ProjectionMatrix").set(m_Camera.getProjectionMatrix());
+        m_Shader->uniform("u_Texture").set(0);
+
+        glActiveTexture(GL_TEXTURE0);
+        m_Icon->getTexture(0)->bind();
+
+        glBindVertexArray(m_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_InstanceStream->id());
+        for (GLuint i = 0; i < 3; i++)
+            glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*) (m_InstanceStream->offset() + i * sizeof(glm::vec4)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        {
+            PROFILE_GPU_ZONE("Particles::draw");
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        }
+        glBindVertexArray(0);
+
+        m_InstanceStream->fence();
+    }
+
+    Clock m_Clock;
+    Camera m_Camera;
+
+    ParticleSystem* m_Particles;
+
+    Shader::Program* m_Shader;
+    Icon* m_Icon;
+
+    GLuint m_VAO;
+    GLuint m_QuadVBO;
+    StreamingBuffer* m_InstanceStream;
+};
+
+int measureUpdates(ParticleSystem& particles, unsigned int updates)
+{
+    particles.update(0.0f);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned int i = 1; i <= updates; i++)
+        particles.update(0.016f * i);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    LOG("backend: %s, particles: %lu, threads: %u, updates: %u, %.2f updates/s, %.2f Mparticles/s\n",
+        particles.simulation().name(),
+        static_cast<unsigned long>(particles.instances().size()),
+        Parallel::concurrency(),
+        updates,
+        updates / seconds,
+        updates * particles.instances().size() / seconds / 1e6);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+
+    size_t count = 1000000;
+    bool opencl = false;
+    unsigned int updates = 0;
+    unsigned int graph = 0;
+    unsigned int links = 3;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--opencl")
+            opencl = true;
+        else if (arg == "--count" && i + 1 < argc)
+            count = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--benchmark" && i + 1 < argc)
+            updates = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--graph" && i + 1 < argc)
+            graph = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--links" && i + 1 < argc)
+            links = std::max(1ul, strtoul(argv[++i], NULL, 10));
+    }
+
+    if (graph > 0)
+        count = graph;
+
+    ParticleSystem particles(count, opencl, graph > 0 ? links : 0);
+
+    if (updates > 0)
+        return measureUpdates(particles, updates);
+
+    rd::Window::Settings settings;
+    settings.Title = std::string("Particles");
+    settings.Width = 1024;
+    settings.Height = 728;
+
+    if (benchmark.headless())
+    {
+        if (!benchmark.open(settings))
+            return EXIT_FAILURE;
+
+        DemoWindow window(&settings, &particles);
+        return benchmark.run(&window);
+    }
+
+    auto demo = new Raindance(argc, argv);
+
+    demo->add(new DemoWindow(&settings, &particles));
+    demo->run();
+
+    delete demo;
+
+    return 0;
+}
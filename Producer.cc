@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "Common/SharedRing.hh"
+
+// Stand-in metric collector feeding the Stream sample through shared memory :
+//
+//     producer [--shm /raindance-stream] [--capacity 4096] [--rate 1000] [--seconds 10]
+//     stream --shm /raindance-stream
+//
+// Pushes a bounded random walk at 'rate' samples per second (0 for as fast as possible) and
+// prints the achieved rate and the reader's lag once per second.
+
+int main(int argc, char** argv)
+{
+    std::string name = "/raindance-stream";
+    unsigned long capacity = 4096;
+    double rate = 1000.0;
+    double seconds = 10.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--shm" && i + 1 < argc)
+            name = argv[++i];
+        else if (arg == "--capacity" && i + 1 < argc)
+            capacity = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--rate" && i + 1 < argc)
+            rate = atof(argv[++i]);
+        else if (arg == "--seconds" && i + 1 < argc)
+            seconds = atof(argv[++i]);
+    }
+
+    SharedRing ring;
+    if (!ring.create(name, capacity))
+    {
+        fprintf(stderr, "Producer : Failed to create shared memory segment %s!\n", name.c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("Producer : Writing to %s (%lu slots), %s\n", name.c_str(), static_cast<unsigned long>(ring.capacity()),
+           rate > 0 ? (std::to_string(static_cast<long>(rate)) + " samples/s").c_str() : "unthrottled");
+
+    typedef std::chrono::steady_clock Time;
+    auto start = Time::now();
+    auto report = start;
+
+    double value = 0.0;
+    unsigned long pushed = 0;
+    unsigned long reported = 0;
+    unsigned long maxLag = 0;
+
+    for (;;)
+    {
+        auto now = Time::now();
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        if (elapsed >= seconds)
+            break;
+
+        if (rate > 0)
+        {
+            // NOTE : Catch up to where the schedule says we should be, then sleep a little.
+            unsigned long target = static_cast<unsigned long>(elapsed * rate);
+            if (pushed >= target)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+        }
+
+        value += 20.0 * (static_cast<double>(rand()) / RAND_MAX - 0.5);
+        value = std::max(-100.0, std::min(100.0, value));
+        ring.push(elapsed, value);
+        pushed++;
+
+        unsigned long lag = static_cast<unsigned long>(ring.lag());
+        maxLag = std::max(maxLag, lag);
+
+        double interval = std::chrono::duration<double>(now - report).count();
+        if (interval >= 1.0)
+        {
+            printf("Producer : %10.0f samples/s, reader lag %8lu (max %lu)\n", (pushed - reported) / interval, lag, maxLag);
+            report = now;
+            reported = pushed;
+            maxLag = 0;
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(Time::now() - start).count();
+    printf("Producer : %lu samples in %.2f s, %.0f samples/s, reader at %lu\n",
+           pushed, elapsed, pushed / elapsed, static_cast<unsigned long>(ring.read()));
+
+    return EXIT_SUCCESS;
+}
@@ -8,6 +8,13 @@
 #include <raindance/Core/Clock.hh>
 #include <raindance/Core/VR/OculusRift.hh>
 
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Capture.hh"
+#include "Common/CommandBuffer.hh"
+#include "Common/Parallel.hh"
+#include "Common/Profiler.hh"
+
 class DemoWindow : public rd::Window
 {
 public:
@@ -18,10 +25,14 @@ public:
         m_Grid = NULL;
         m_Cube = NULL;
         m_Shader = NULL;
+        m_Queue = NULL;
     }
 
     virtual ~DemoWindow()
     {
+        if (m_Queue)
+            m_Queue->dump("Stereo/queue");
+        delete m_Queue;
         ResourceManager::getInstance().unload(m_Shader);
         delete m_Cube;
         delete m_Grid;
@@ -54,8 +65,16 @@ public:
             FS::TextFile frag("Assets/stereo_cube.frag");
             m_Shader = ResourceManager::getInstance().loadShader("Stereo/cube", vert.content(), frag.content());
             m_Shader->dump();
+
+            m_Shader->use();
+            m_Shader->uniform("u_Tint").set(glm::vec4(WHITE, 1.0));
+            m_ModelViewProjection = Uniforms::Location(Uniforms::current(), "u_ModelViewProjectionMatrix");
         }
 
+        m_Queue = new RenderQueue();
+        m_CubeProgram = m_Queue->program(m_Shader);
+        m_CubeGeometry = m_Queue->geometry(&m_Cube->getTriangleVertexBuffer());
+
         m_UserPosition = glm::vec3(0.0, 2.0, 5.0);
         m_UserTarget = glm::vec3(0.0, 2.0, 0.0);
         m_UserUp = glm::vec3(0.0, 1.0, 0.0);
@@ -64,62 +83,99 @@ public:
         glEnable(GL_DEPTH_TEST);
     }
 
-    void drawScene(Context* context, Camera& camera, Transformation& transformation)
+    void recordCubes(CommandBuffer& commands, const glm::mat4& viewProjection)
     {
-        //glDrawBuffer(buffer);
-
-        m_Axis->draw(context, camera, transformation);
-
-        transformation.push();
-        transformation.translate(glm::vec3(-50.0f, 0.0, -50.0));
-        transformation.rotate(90, glm::vec3(1, 0, 0));
-        m_Grid->draw(context, camera, transformation);
-        transformation.pop();
-
-        transformation.push();
-                
-        m_Shader->use();
-        m_Shader->uniform("u_Tint").set(glm::vec4(WHITE, 1.0));
+        GLsizei count = m_Cube->getTriangleVertexBuffer().size() / sizeof(Cube::Vertex);
+        Transformation transformation;
 
+        commands.clear();
         for (float x = -50; x <= 50; x += 5.0)
             for (float z = -50; z <= 50; z += 5.0)
             {
                 transformation.push();
 
                 transformation.translate(glm::vec3(x, 0.51, z));
-                m_Cube->draw(context, camera, transformation, m_Shader, Cube::TRIANGLES);
-        
+                commands.uniform(m_ModelViewProjection, viewProjection * transformation.state());
+                commands.draw(m_CubeProgram, m_CubeGeometry, GL_TRIANGLES, 0, count);
+
                 transformation.pop();
             }
+    }
+
+    void drawScene(Context* context, Camera& camera, Transformation& transformation, CommandBuffer& cubes)
+    {
+        //glDrawBuffer(buffer);
+
+        {
+            PROFILE_GPU_ZONE("Axis::draw");
+            m_Axis->draw(context, camera, transformation);
+        }
+
+        transformation.push();
+        transformation.translate(glm::vec3(-50.0f, 0.0, -50.0));
+        transformation.rotate(90, glm::vec3(1, 0, 0));
+        {
+            PROFILE_GPU_ZONE("Grid::draw");
+            m_Grid->draw(context, camera, transformation);
+        }
+        transformation.pop();
 
-        transformation.pop();   
+        {
+            PROFILE_GPU_ZONE("Cube::draw");
+            m_Queue->submit(context, &cubes);
+        }
     }
 
     void draw(Context* context) override
     {
+        PROFILE_GPU_ZONE("Window::draw");
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
      
         Transformation transformation;
 
         auto framebuffer = this->getViewport().getFramebuffer();
 
+        const OculusRift::Eye eyes[2] = { OculusRift::LEFT, OculusRift::RIGHT };
+        glm::mat4 viewProjection[2];
+        for (int eye = 0; eye < 2; eye++)
+        {
+            m_Rift->lookAt(eyes[eye], m_UserPosition, m_UserTarget, m_UserUp, m_Camera);
+            viewProjection[eye] = m_Camera.getProjectionMatrix() * m_Camera.getViewMatrix();
+        }
+
+        {
+            PROFILE_ZONE("Cube::record");
+            Parallel::forEach(2, [&](size_t begin, size_t end)
+            {
+                for (size_t eye = begin; eye < end; eye++)
+                    recordCubes(m_CubeCommands[eye], viewProjection[eye]);
+            }, 1);
+        }
+
         glViewport(0, 0, framebuffer.Width / 2, framebuffer.Height);
         {
             m_Rift->lookAt(OculusRift::LEFT, m_UserPosition, m_UserTarget, m_UserUp, m_Camera);
-            drawScene(context, m_Camera, transformation);
+            drawScene(context, m_Camera, transformation, m_CubeCommands[0]);
         }
 
         glViewport(framebuffer.Width / 2, 0, framebuffer.Width / 2, framebuffer.Height);
         {
             m_Rift->lookAt(OculusRift::RIGHT, m_UserPosition, m_UserTarget, m_UserUp, m_Camera);
-            drawScene(context, m_Camera, transformation);
+            drawScene(context, m_Camera, transformation, m_CubeCommands[1]);
         }
 
         checkGLErrors();
+
+        m_Capture.frame();
+
+        Profiler::getInstance().frame(context);
     }
 
     void idle(Context* context) override
     {
+        PROFILE_ZONE("Window::idle");
+
         (void) context;
 
         m_Rift->idle();
@@ -157,6 +213,8 @@ public:
     void setOculusRift(OculusRift* rift) { m_Rift = rift; }
 
 private:
+    Capture m_Capture;
+
     Camera m_Camera;
     Axis* m_Axis;
     Grid* m_Grid;
@@ -164,6 +222,12 @@ private:
     Shader::Program* m_Shader;
     Clock m_Clock;
 
+    Uniforms::Location m_ModelViewProjection;
+    RenderQueue* m_Queue;
+    uint16_t m_CubeProgram;
+    uint16_t m_CubeGeometry;
+    CommandBuffer m_CubeCommands[2];
+
     OculusRift* m_Rift;
 
     glm::vec3 m_UserPosition;
@@ -173,9 +237,11 @@ private:
 
 int main(int argc, char** argv)
 {
-    OculusRift rift;
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+    Capture::configure(argc, argv);
 
-    auto demo = new Raindance(argc, argv);
+    OculusRift rift;
 
     rd::Window::Settings settings;
     settings.Title = std::string("Stereo");
@@ -184,6 +250,18 @@ int main(int argc, char** argv)
     settings.Fullscreen = true;
     settings.Monitor = rift.findMonitor();
 
+    if (benchmark.headless())
+    {
+        if (!benchmark.open(settings))
+            return EXIT_FAILURE;
+
+        DemoWindow window(&settings);
+        window.setOculusRift(&rift);
+        return benchmark.run(&window);
+    }
+
+    auto demo = new Raindance(argc, argv);
+
     auto window = new DemoWindow(&settings);
 
     window->setOculusRift(&rift);
@@ -6,7 +6,20 @@
 #include <raindance/Core/Transformation.hh>
 #include <raindance/Core/Icon.hh>
 
-#include <raindance/Core/Primitives/Polyline.hh>
+#include <chrono>
+
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Capture.hh"
+#include "Common/Memory.hh"
+#include "Common/Profiler.hh"
+#include "Common/Replay.hh"
+#include "Common/SeriesStats.hh"
+#include "Common/SharedRing.hh"
+#include "Common/StreamingBuffer.hh"
+
+// Name of the shm segment to read samples from (--shm), random samples when empty.
+std::string g_Feed;
 
 class TimeSerie
 {
@@ -14,35 +27,81 @@ public:
 
     TimeSerie(size_t size, const glm::vec4& color)
     {
+        MEMORY_SCOPE("Stream::TimeSerie");
+
         m_Values.resize(size);
+        MemoryTracker::getInstance().track(m_Values.data(), m_Values.capacity() * sizeof(glm::vec2));
         m_Begin = 0;
         m_End = 0;
+        m_Color = color;
 
-        m_Polyline = new Polyline();
-        m_Polyline->setColor(color);
+        FS::TextFile vert("Assets/stream_timeserie.vert");
+        FS::TextFile frag("Assets/stream_timeserie.frag");
+        m_Shader = ResourceManager::getInstance().loadShader("Stream/TimeSerie", vert.content(), frag.content());
+
+        // NOTE : The whole ring is re-sent every frame, so it goes through a fenced region instead of a glBufferData().
+        m_Stream = new StreamingBuffer(GL_ARRAY_BUFFER, size * sizeof(glm::vec2));
+
+        glGenVertexArrays(1, &m_VAO);
+        glBindVertexArray(m_VAO);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
     }
 
     virtual ~TimeSerie()
     {
-        SAFE_DELETE(m_Polyline);
+        MemoryTracker::getInstance().untrack(m_Values.data());
+        glDeleteVertexArrays(1, &m_VAO);
+        SAFE_DELETE(m_Stream);
+        ResourceManager::getInstance().unload(m_Shader);
     }
 
     virtual void draw(Context* context, Camera& camera)
     {
+        PROFILE_GPU_ZONE("TimeSerie::draw");
+
+        (void) context;
+
+        size_t count = size();
+        if (count < 2)
+            return;
+
+        glm::vec2* data = static_cast<glm::vec2*>(m_Stream->map());
+        if (data == NULL)
+            return;
+
+        // NOTE : Oldest sample first, the ring is copied in at most two pieces.
+        if (m_Begin < m_End)
+            std::copy(m_Values.begin() + m_Begin, m_Values.begin() + m_End, data);
+        else
+        {
+            data = std::copy(m_Values.begin() + m_Begin, m_Values.end(), data);
+            std::copy(m_Values.begin(), m_Values.begin() + m_End, data);
+        }
+        m_Stream->unmap();
+
         glEnable(GL_BLEND);
         glBlendFunc (GL_SRC_ALPHA, GL_DST_ALPHA);
 
-        Transformation transformation;
+        m_Shader->use();
+        m_Shader->uniform("u_ModelViewMatrix").set(camera.getViewMatrix());
+        m_Shader->uniform("u_ProjectionMatrix").set(camera.getProjectionMatrix());
+        m_Shader->uniform("u_Color").set(m_Color);
 
-        m_Polyline->draw(*context, camera, transformation, m_Values, m_Begin, m_End);
+        glBindVertexArray(m_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_Stream->id());
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*) m_Stream->offset());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glDrawArrays(GL_LINE_STRIP, 0, count);
+        glBindVertexArray(0);
+
+        m_Stream->fence();
     }
 
     virtual void push(float timestamp, float value)
     {
-        Polyline::Vertex v = {};
-        v.Position = glm::vec3(timestamp, value, 0.0);
-  
-        m_Values[m_End] = v;
+        m_Values[m_End] = glm::vec2(timestamp, value);
         m_End = (m_End + 1) % m_Values.size();
 
         if (m_End == m_Begin)
@@ -70,7 +129,7 @@ public:
                 index = m_Values.size();
             index--;
 
-            value = m_Values[index].Position.y;
+            value = m_Values[index].y;
 
             if (value > *max)
                 *max = value;
@@ -88,14 +147,19 @@ public:
         *average = sum / count;
     }
 
-    inline void setWidth(float value) { m_Polyline->setWidth(value); }
-    inline float getWidth() { return m_Polyline->getWidth(); }
+    inline size_t size() const { return (m_End + m_Values.size() - m_Begin) % m_Values.size(); }
+
+    inline StreamingBuffer& stream() { return *m_Stream; }
 
 protected:
     size_t m_Begin;
     size_t m_End;
-    std::vector<Polyline::Vertex> m_Values;
-    Polyline* m_Polyline;
+    std::vector<glm::vec2> m_Values;
+    glm::vec4 m_Color;
+
+    Shader::Program* m_Shader;
+    GLuint m_VAO;
+    StreamingBuffer* m_Stream;
 };
 
 class DemoWindow : public rd::Window
@@ -129,15 +193,29 @@ public:
             params.Color = glm::vec4(0.02, 0.15, 0.4, 1.0);
             //params.BackgroundColor = 0.5f * params.Color;
             
+            MEMORY_SCOPE("Stream::Grid");
             m_Grid = new Grid(params);
         }
 
+        // NOTE : When replaying, the feed's samples come from the log instead.
+        if (!g_Feed.empty() && !Replay::getInstance().replaying())
+        {
+            if (m_Feed.open(g_Feed))
+                LOG("Stream : Reading samples from %s (%lu slots)\n", g_Feed.c_str(), static_cast<unsigned long>(m_Feed.capacity()));
+            else
+                LOG("Stream : Failed to open shared memory feed %s, using random samples!\n", g_Feed.c_str());
+        }
+
+        m_Count = 0;
+
         glClearColor(0.1, 0.1, 0.1, 1.0);
         glDisable(GL_DEPTH_TEST);
     }
 
     virtual ~DemoWindow()
     {
+        m_TimeSerie->stream().dump("Stream/TimeSerie");
+
         SAFE_DELETE(m_TimeSerie);
         SAFE_DELETE(m_TimeSerieAvg1);
         SAFE_DELETE(m_TimeSerieAvg2);
@@ -145,6 +223,9 @@ public:
         SAFE_DELETE(m_TimeSerieMax);
 
         SAFE_DELETE(m_Grid);
+
+        if (m_Feed.valid())
+            LOG("Stream : %lu samples read, %lu lost to overruns\n", m_Count, static_cast<unsigned long>(m_Feed.overrun()));
     }
     
     virtual void initialize(Context* context)
@@ -154,13 +235,18 @@ public:
 
     virtual void draw(Context* context)
     {
+        PROFILE_GPU_ZONE("Window::draw");
+
         Transformation transformation;
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         transformation.push();
         transformation.translate(glm::vec3(0, -100, 0));
-        m_Grid->draw(context, m_Camera, transformation);
+        {
+            PROFILE_GPU_ZONE("Grid::draw");
+            m_Grid->draw(context, m_Camera, transformation);
+        }
         transformation.pop();
 
         m_TimeSerie->draw(context, m_Camera);
@@ -168,60 +254,95 @@ public:
         m_TimeSerieAvg2->draw(context, m_Camera);
         m_TimeSerieMin->draw(context, m_Camera);
         m_TimeSerieMax->draw(context, m_Camera);
+
+        m_Capture.frame();
+
+        Profiler::getInstance().frame(context);
+    }
+
+    void push(float value)
+    {
+        float tscale = static_cast<float>(m_Count);
+
+        float moving_min;
+        float moving_max;
+        float moving_avg;
+
+        m_TimeSerie->push(tscale, value);
+
+        m_TimeSerie->getStats(25, &moving_avg, &moving_min, &moving_max);
+        m_TimeSerieAvg1->push(tscale, moving_avg);
+        m_TimeSerieMin->push(tscale, moving_min);
+        m_TimeSerieMax->push(tscale, moving_max);
+
+        m_TimeSerie->getStats(50, &moving_avg, &moving_min, &moving_max);
+        m_TimeSerieAvg2->push(tscale, moving_avg);
+
+        m_Count++;
+
+        if (m_Count >= 600)
+            m_Grid->parameters().Shift.x += 1.0;
     }
 
     virtual void idle(Context* context)
     {
-        (void) context;
+        PROFILE_ZONE("Window::idle");
+
+        Replay& replay = Replay::getInstance();
+
+        if (m_Feed.valid() || (replay.replaying() && !g_Feed.empty()))
+        {
+            replay.tick(context->clock().seconds());
+
+            if (replay.replaying())
+            {
+                double value;
+                while (replay.input(value))
+                    push(static_cast<float>(value));
+                return;
+            }
+
+            // NOTE : Samples are read in place from the mapping, however many arrived since last frame.
+            m_Feed.poll([this, &replay](const SharedRing::Sample& sample)
+            {
+                double value = sample.Value;
+                replay.input(value);
+                push(static_cast<float>(value));
+            });
+            return;
+        }
 
         static bool _first = true;
         static float _lastTime;
         static float _value = 0.0;
-        static unsigned int _count = 0;
 
         if (_first)
         {
             context->clock().start();
-            _lastTime = context->clock().seconds();
+            _lastTime = 0.0f;
             _first = false;
         }
 
-        float t = context->clock().seconds();
+        float t = replay.tick(context->clock().seconds());
 
         float min = -100.0f;
         float max = +100.0f;
 
-        float moving_min;
-        float moving_max;
-        float moving_avg;
-
         if (t - _lastTime >= 0.030f)
         {
-            float tscale = static_cast<float>(_count);
-
-            LOG("%f\t%f\n", tscale, _value);
-
-            m_TimeSerie->push(tscale, _value);
+            LOG("%f\t%f\n", static_cast<float>(m_Count), _value);
 
-            m_TimeSerie->getStats(25, &moving_avg, &moving_min, &moving_max);
-            m_TimeSerieAvg1->push(tscale, moving_avg);
-            m_TimeSerieMin->push(tscale, moving_min);
-            m_TimeSerieMax->push(tscale, moving_max);
-
-            m_TimeSerie->getStats(50, &moving_avg, &moving_min, &moving_max);
-            m_TimeSerieAvg2->push(tscale, moving_avg);    
+            push(_value);
 
             _value += RANDOM_FLOAT(-10.0, 10.0);
             _value = std::max(min, std::min(max, _value));
             _lastTime = t;     
-            _count ++;
-
-            if (_count >= 600)
-            m_Grid->parameters().Shift.x += 1.0;
         }
     }
 
 private:
+    Capture m_Capture;
+
     Camera m_Camera;
     TimeSerie* m_TimeSerie;
     TimeSerie* m_TimeSerieAvg1;
@@ -230,17 +351,90 @@ private:
     TimeSerie* m_TimeSerieMax;
 
     Grid* m_Grid;
+
+    SharedRing m_Feed;
+    unsigned long m_Count;
 };
 
+// Synthetic load for SeriesStats : 'count' series receiving samples at irregular intervals
+// (50 per second on average), with 5 second windows updated at 60 ticks per second.
+int measureSeriesStats(size_t count)
+{
+    const double window = 5.0;
+    const double tick = 1.0 / 60.0;
+    SeriesStats stats(count, 512, window);
+
+    std::vector<double> next(count, 0.0);
+    std::vector<float> values(count, 0.0f);
+
+    double now = 0.0;
+    double elapsed = 0.0;
+    unsigned long samples = 0;
+    unsigned int ticks = 0;
+
+    for (unsigned int i = 0; i < 20 * 60; i++)
+    {
+        now += tick;
+        for (size_t series = 0; series < count; series++)
+        {
+            while (next[series] <= now)
+            {
+                values[series] += RANDOM_FLOAT(-10.0, 10.0);
+                stats.push(series, next[series], values[series]);
+                next[series] += RANDOM_FLOAT(0.0, 0.04);
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        stats.update(now);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        // NOTE : Only measure once the windows are full.
+        if (now >= window)
+        {
+            elapsed += std::chrono::duration<double>(end - start).count();
+            for (size_t series = 0; series < count; series++)
+                samples += stats.count(series);
+            ticks++;
+        }
+    }
+
+    LOG("series: %lu, threads: %u, %.1f MB, %.0f samples/window, %.3f ms/tick, %.2f Msamples/s\n",
+        static_cast<unsigned long>(count),
+        Parallel::concurrency(),
+        stats.memory() / (1024.0 * 1024.0),
+        static_cast<double>(samples) / ticks / count,
+        elapsed * 1000.0 / ticks,
+        samples / elapsed / 1e6);
+
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
-    auto demo = new Raindance(argc, argv);
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+    Capture::configure(argc, argv);
+    Replay::getInstance().configure(argc, argv);
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--shm" && i + 1 < argc)
+            g_Feed = argv[++i];
+        else if (arg == "--series-stats" && i + 1 < argc)
+            return measureSeriesStats(strtoul(argv[++i], NULL, 10));
+    }
 
     rd::Window::Settings settings;
     settings.Title = std::string("Stream");
     settings.Width = 600;
     settings.Height = 200;
 
+    if (benchmark.headless())
+        return benchmark.run<DemoWindow>(settings);
+
+    auto demo = new Raindance(argc, argv);
     demo->add(new DemoWindow(&settings));
     demo->run();
 
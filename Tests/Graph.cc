@@ -0,0 +1,90 @@
+#include <raindance/Raindance.hh>
+
+#include "Common/Graph.hh"
+
+// Checks the per-node CSR gather of the attraction forces against the sequential per-edge
+// loop, on Barabasi-Albert graphs where a few hubs collect most of the edges.
+//
+// graph_test [--nodes N] [--links M] [--seed S]
+
+static bool compare(unsigned int nodes, unsigned int links)
+{
+    std::vector<CSR::Edge> edges = Graph::barabasiAlbert(nodes, links);
+    CSR csr(nodes, edges);
+
+    unsigned int hub = 0;
+    for (unsigned int i = 0; i < nodes; i++)
+        hub = std::max(hub, csr.degree(i));
+
+    if (csr.neighbors().size() != 2 * edges.size())
+    {
+        LOG("Graph : %u nodes, CSR holds %lu neighbors for %lu edges!\n", nodes,
+            static_cast<unsigned long>(csr.neighbors().size()), static_cast<unsigned long>(edges.size()));
+        return false;
+    }
+
+    std::vector<glm::vec4> positions(nodes);
+    for (auto& position : positions)
+        position = glm::vec4(RANDOM_FLOAT(-1000.0, 1000.0), RANDOM_FLOAT(-1000.0, 1000.0), RANDOM_FLOAT(-1000.0, 1000.0), 0.0);
+
+    const float k = 50.0;
+    std::vector<glm::vec4> gathered(nodes, glm::vec4(0.0));
+    std::vector<glm::vec4> reference(nodes, glm::vec4(0.0));
+    Layout::attraction(positions, csr, k, gathered);
+    Layout::attractionReference(positions, edges, k, reference);
+
+    // NOTE : Both sum the same terms in a different order, allow float rounding on the largest force.
+    float largest = 0.0;
+    for (auto& force : reference)
+        largest = std::max(largest, glm::length(force));
+
+    float error = 0.0;
+    unsigned int worst = 0;
+    for (unsigned int i = 0; i < nodes; i++)
+    {
+        float difference = glm::length(gathered[i] - reference[i]);
+        if (difference > error)
+        {
+            error = difference;
+            worst = i;
+        }
+    }
+
+    bool passed = error <= 1e-5 * largest;
+    LOG("Graph : %u nodes, %lu edges, largest degree %u, max error %g (relative %g, node %u) %s\n",
+        nodes, static_cast<unsigned long>(edges.size()), hub, error, largest > 0 ? error / largest : 0.0, worst,
+        passed ? "passed" : "FAILED");
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int nodes = 0;
+    unsigned int links = 3;
+    unsigned int seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--nodes" && i + 1 < argc)
+            nodes = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--links" && i + 1 < argc)
+            links = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 10);
+    }
+
+    srand(seed);
+
+    bool passed = true;
+    if (nodes > 0)
+        passed = compare(nodes, links);
+    else
+    {
+        const unsigned int sizes[] = { 10, 1000, 20000 };
+        for (auto size : sizes)
+            passed &= compare(size, links);
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
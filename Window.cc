@@ -1,5 +1,11 @@
 #include <raindance/Raindance.hh>
 
+#define RD_BENCHMARK_IMPLEMENTATION
+#include "Common/Benchmark.hh"
+#include "Common/Profiler.hh"
+#include "Common/Redraw.hh"
+#include "Common/Wall.hh"
+
 class DemoWindow : public rd::Window
 {
 public:
@@ -20,31 +26,91 @@ public:
 
     virtual void draw(Context* context)
     {
-        (void) context;
+        PROFILE_GPU_ZONE("Window::draw");
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        Profiler::getInstance().frame(context);
+    }
+
+    virtual void reshape(int width, int height)
+    {
+        (void) width;
+        (void) height;
+
+        m_Redraw.invalidate();
+    }
+
+    virtual void onKey(int key, int scancode, int action, int mods)
+    {
+        (void) key;
+        (void) scancode;
+        (void) action;
+        (void) mods;
+
+        m_Redraw.invalidate();
     }
 
     virtual void idle(Context* context)
     {
+        m_Redraw.wait();
+
+        PROFILE_ZONE("Window::idle");
+
         (void) context;
     }
 
 private:
+    Redraw m_Redraw;
+
     Camera m_Camera;
 };
 
+// window [--windows N [--threaded]]
+//
+// One window by default. Extra windows share the main loop thread, or with --threaded each
+// render on their own thread through Wall.
+
 int main(int argc, char** argv)
 {
-    auto demo = new Raindance(argc, argv);
+    Benchmark::Runner benchmark(argc, argv);
+    Profiler::getInstance().configure(argc, argv);
+    Redraw::configure(argc, argv);
 
-    rd::Window::Settings settings;
-    settings.Title = std::string("Window");
-    settings.Width = 1024;
-    settings.Height = 728;
+    unsigned int windows = 1;
+    bool threaded = false;
 
-    demo->add(new DemoWindow(&settings));
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--windows" && i + 1 < argc)
+            windows = std::max(1ul, strtoul(argv[++i], NULL, 10));
+        else if (arg == "--threaded")
+            threaded = true;
+    }
 
-    // TODO : demo->add(new DemoWindow("Window 2", 800, 600));
+    std::vector<rd::Window::Settings> settings(windows);
+    for (unsigned int i = 0; i < windows; i++)
+    {
+        settings[i].Title = i == 0 ? std::string("Window") : std::string("Window ") + std::to_string(i + 1);
+        settings[i].Width = i == 0 ? 1024 : 800;
+        settings[i].Height = i == 0 ? 728 : 600;
+    }
+
+    if (benchmark.headless())
+        return benchmark.run<DemoWindow>(settings[0]);
+
+    if (threaded)
+    {
+        Wall wall;
+        for (auto& window : settings)
+            wall.add(window, [](rd::Window::Settings* s) -> rd::Window* { return new DemoWindow(s); });
+        return wall.run();
+    }
+
+    auto demo = new Raindance(argc, argv);
+    for (auto& window : settings)
+        demo->add(new DemoWindow(&window));
 
     demo->run();
 